@@ -100,6 +100,26 @@ lb_type BDDTag::insert(tag_off pos) {
   return cur_lb;
 }
 
+// Same as lbs[i] = insert(pos + i), but the zero path to pos is walked only
+// once and then extended by one zero per label.
+void BDDTag::insert_n(tag_off pos, size_t n, lb_type *lbs) {
+  lb_type cur_lb = insert_n_zeros(ROOT, pos, ROOT);
+  for (size_t i = 0; i < n; i++) {
+    lbs[i] = insert_n_ones(cur_lb, 1, ROOT);
+    if (i + 1 < n)
+      cur_lb = insert_n_zeros(cur_lb, 1, ROOT);
+  }
+}
+
+// The label of the whole segment [begin, end): one zero run and one run of
+// ones, instead of end - begin labels combined pairwise.
+lb_type BDDTag::insert_range(tag_off begin, tag_off end) {
+  if (end <= begin)
+    return ROOT;
+  lb_type cur_lb = insert_n_zeros(ROOT, begin, ROOT);
+  return insert_n_ones(cur_lb, end - begin, ROOT);
+}
+
 void BDDTag::set_sign(lb_type lb) { nodes[lb].seg.sign = true; }
 bool BDDTag::get_sign(lb_type lb) { return nodes[lb].seg.sign; }
 
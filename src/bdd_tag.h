@@ -57,6 +57,8 @@ public:
   BDDTag();
   ~BDDTag();
   lb_type insert(tag_off pos);
+  void insert_n(tag_off pos, size_t n, lb_type *lbs);
+  lb_type insert_range(tag_off begin, tag_off end);
   void set_sign(lb_type lb);
   bool get_sign(lb_type lb);
   void set_size(lb_type lb, size_t size);
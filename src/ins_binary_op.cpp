@@ -40,32 +40,28 @@ static void PIN_FAST_ANALYSIS_CALL r2r_binary_opw(THREADID tid, uint32_t dst,
                                                   uint32_t src) {
   tag_t *src_tags = RTAG[src];
   tag_t *dst_tags = RTAG[dst];
-  for (size_t i = 0; i < 2; i++)
-    dst_tags[i] = tag_combine(dst_tags[i], src_tags[i],tid);
+  tag_combine_v(dst_tags, dst_tags, src_tags, 2, tid);
 }
 
 static void PIN_FAST_ANALYSIS_CALL r2r_binary_opl(THREADID tid, uint32_t dst,
                                                   uint32_t src) {
   tag_t *src_tags = RTAG[src];
   tag_t *dst_tags = RTAG[dst];
-  for (size_t i = 0; i < 4; i++)
-    dst_tags[i] = tag_combine(dst_tags[i], src_tags[i],tid);
+  tag_combine_v(dst_tags, dst_tags, src_tags, 4, tid);
 }
 
 static void PIN_FAST_ANALYSIS_CALL r2r_binary_opq(THREADID tid, uint32_t dst,
                                                   uint32_t src) {
   tag_t *src_tags = RTAG[src];
   tag_t *dst_tags = RTAG[dst];
-  for (size_t i = 0; i < 8; i++)
-    dst_tags[i] = tag_combine(dst_tags[i], src_tags[i],tid);
+  tag_combine_v(dst_tags, dst_tags, src_tags, 8, tid);
 }
 
 static void PIN_FAST_ANALYSIS_CALL r2r_binary_opx(THREADID tid, uint32_t dst,
                                                   uint32_t src) {
   tag_t *src_tags = RTAG[src];
   tag_t *dst_tags = RTAG[dst];
-  for (size_t i = 0; i < 16; i++)
-    dst_tags[i] = tag_combine(dst_tags[i], src_tags[i],tid);
+  tag_combine_v(dst_tags, dst_tags, src_tags, 16, tid);
 }
 
 static void PIN_FAST_ANALYSIS_CALL r2r_binary_opy(THREADID tid, uint32_t dst,
@@ -73,8 +69,7 @@ static void PIN_FAST_ANALYSIS_CALL r2r_binary_opy(THREADID tid, uint32_t dst,
 
   tag_t *src_tags = RTAG[src];
   tag_t *dst_tags = RTAG[dst];
-  for (size_t i = 0; i < 32; i++)
-    dst_tags[i] = tag_combine(dst_tags[i], src_tags[i],tid);
+  tag_combine_v(dst_tags, dst_tags, src_tags, 32, tid);
 }
 
 static void PIN_FAST_ANALYSIS_CALL m2r_binary_opb_u(THREADID tid, uint32_t dst,
@@ -95,37 +90,52 @@ static void PIN_FAST_ANALYSIS_CALL m2r_binary_opb_l(THREADID tid, uint32_t dst,
 
 static void PIN_FAST_ANALYSIS_CALL m2r_binary_opw(THREADID tid, uint32_t dst,
                                                   ADDRINT src) {
+  if (tagmap_range_clean(src, 2))
+    return;
   tag_t *dst_tags = RTAG[dst];
-  for (size_t i = 0; i < 2; i++)
-    dst_tags[i] = tag_combine(dst_tags[i], MTAG(src + i),tid);
+  tag_t src_tags[2];
+  tagmap_getw(src, 2, src_tags);
+  tag_combine_v(dst_tags, dst_tags, src_tags, 2, tid);
 }
 
 static void PIN_FAST_ANALYSIS_CALL m2r_binary_opl(THREADID tid, uint32_t dst,
                                                   ADDRINT src) {
+  if (tagmap_range_clean(src, 4))
+    return;
   tag_t *dst_tags = RTAG[dst];
-  for (size_t i = 0; i < 4; i++)
-    dst_tags[i] = tag_combine(dst_tags[i], MTAG(src + i),tid);
+  tag_t src_tags[4];
+  tagmap_getw(src, 4, src_tags);
+  tag_combine_v(dst_tags, dst_tags, src_tags, 4, tid);
 }
 
 static void PIN_FAST_ANALYSIS_CALL m2r_binary_opq(THREADID tid, uint32_t dst,
                                                   ADDRINT src) {
+  if (tagmap_range_clean(src, 8))
+    return;
   tag_t *dst_tags = RTAG[dst];
-  for (size_t i = 0; i < 8; i++)
-    dst_tags[i] = tag_combine(dst_tags[i], MTAG(src + i),tid);
+  tag_t src_tags[8];
+  tagmap_getw(src, 8, src_tags);
+  tag_combine_v(dst_tags, dst_tags, src_tags, 8, tid);
 }
 
 static void PIN_FAST_ANALYSIS_CALL m2r_binary_opx(THREADID tid, uint32_t dst,
                                                   ADDRINT src) {
+  if (tagmap_range_clean(src, 16))
+    return;
   tag_t *dst_tags = RTAG[dst];
-  for (size_t i = 0; i < 16; i++)
-    dst_tags[i] = tag_combine(dst_tags[i], MTAG(src + i),tid);
+  tag_t src_tags[16];
+  tagmap_getw(src, 16, src_tags);
+  tag_combine_v(dst_tags, dst_tags, src_tags, 16, tid);
 }
 
 static void PIN_FAST_ANALYSIS_CALL m2r_binary_opy(THREADID tid, uint32_t dst,
                                                   ADDRINT src) {
+  if (tagmap_range_clean(src, 32))
+    return;
   tag_t *dst_tags = RTAG[dst];
-  for (size_t i = 0; i < 32; i++)
-    dst_tags[i] = tag_combine(dst_tags[i], MTAG(src + i),tid);
+  tag_t src_tags[32];
+  tagmap_getw(src, 32, src_tags);
+  tag_combine_v(dst_tags, dst_tags, src_tags, 32, tid);
 }
 
 static void PIN_FAST_ANALYSIS_CALL r2m_binary_opb_u(THREADID tid, ADDRINT dst,
@@ -148,37 +158,57 @@ static void PIN_FAST_ANALYSIS_CALL r2m_binary_opb_l(THREADID tid, ADDRINT dst,
 
 static void PIN_FAST_ANALYSIS_CALL r2m_binary_opw(THREADID tid, ADDRINT dst,
                                                   uint32_t src) {
+  if (RTAG_CLEAN(src, 2))
+    return;
   tag_t *src_tags = RTAG[src];
-  for (size_t i = 0; i < 2; i++)
-    tagmap_setb(dst + i, tag_combine(MTAG(dst + i), src_tags[i],tid));
+  tag_t dst_tags[2];
+  tagmap_getw(dst, 2, dst_tags);
+  tag_combine_v(dst_tags, dst_tags, src_tags, 2, tid);
+  tagmap_setw(dst, 2, dst_tags);
 }
 
 static void PIN_FAST_ANALYSIS_CALL r2m_binary_opl(THREADID tid, ADDRINT dst,
                                                   uint32_t src) {
+  if (RTAG_CLEAN(src, 4))
+    return;
   tag_t *src_tags = RTAG[src];
-  for (size_t i = 0; i < 4; i++)
-    tagmap_setb(dst + i, tag_combine(MTAG(dst + i), src_tags[i],tid));
+  tag_t dst_tags[4];
+  tagmap_getw(dst, 4, dst_tags);
+  tag_combine_v(dst_tags, dst_tags, src_tags, 4, tid);
+  tagmap_setw(dst, 4, dst_tags);
 }
 
 static void PIN_FAST_ANALYSIS_CALL r2m_binary_opq(THREADID tid, ADDRINT dst,
                                                   uint32_t src) {
+  if (RTAG_CLEAN(src, 8))
+    return;
   tag_t *src_tags = RTAG[src];
-  for (size_t i = 0; i < 8; i++)
-    tagmap_setb(dst + i, tag_combine(MTAG(dst + i), src_tags[i],tid));
+  tag_t dst_tags[8];
+  tagmap_getw(dst, 8, dst_tags);
+  tag_combine_v(dst_tags, dst_tags, src_tags, 8, tid);
+  tagmap_setw(dst, 8, dst_tags);
 }
 
 static void PIN_FAST_ANALYSIS_CALL r2m_binary_opx(THREADID tid, ADDRINT dst,
                                                   uint32_t src) {
+  if (RTAG_CLEAN(src, 16))
+    return;
   tag_t *src_tags = RTAG[src];
-  for (size_t i = 0; i < 16; i++)
-    tagmap_setb(dst + i, tag_combine(MTAG(dst + i), src_tags[i],tid));
+  tag_t dst_tags[16];
+  tagmap_getw(dst, 16, dst_tags);
+  tag_combine_v(dst_tags, dst_tags, src_tags, 16, tid);
+  tagmap_setw(dst, 16, dst_tags);
 }
 
 static void PIN_FAST_ANALYSIS_CALL r2m_binary_opy(THREADID tid, ADDRINT dst,
                                                   uint32_t src) {
+  if (RTAG_CLEAN(src, 32))
+    return;
   tag_t *src_tags = RTAG[src];
-  for (size_t i = 0; i < 32; i++)
-    tagmap_setb(dst + i, tag_combine(MTAG(dst + i), src_tags[i],tid));
+  tag_t dst_tags[32];
+  tagmap_getw(dst, 32, dst_tags);
+  tag_combine_v(dst_tags, dst_tags, src_tags, 32, tid);
+  tagmap_setw(dst, 32, dst_tags);
 }
 
 void ins_binary_op(INS ins) {
@@ -54,6 +54,20 @@
         RTAG[(RIDX)][30], RTAG[(RIDX)][31]                                     \
   }
 
+/* true if the first N tags of a register are all empty */
+inline bool rtag_clean(tag_t const *tags, size_t n) {
+#ifdef TAG_BOOL
+  return tag_bytes_clean(tags, n);
+#else
+  for (size_t i = 0; i < n; i++) {
+    if (!tag_is_empty(tags[i]))
+      return false;
+  }
+  return true;
+#endif
+}
+#define RTAG_CLEAN(RIDX, N) rtag_clean(RTAG[(RIDX)], (N))
+
 #define MTAG(ADDR) tagmap_getb((ADDR))
 #define M8TAG(ADDR)                                                            \
   { tagmap_getb((ADDR)) }
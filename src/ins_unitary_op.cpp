@@ -37,10 +37,8 @@ static void PIN_FAST_ANALYSIS_CALL r2r_unitary_opq(THREADID tid, uint32_t src) {
   tag_t dst1_tag[] = R64TAG(DFT_REG_RDX);
   tag_t dst2_tag[] = R64TAG(DFT_REG_RAX);
 
-  for (size_t i = 0; i < 8; i++) {
-    RTAG[DFT_REG_RDX][i] = tag_combine(dst1_tag[i], tmp_tag[i],tid);
-    RTAG[DFT_REG_RAX][i] = tag_combine(dst2_tag[i], tmp_tag[i],tid);
-  }
+  tag_combine_v(RTAG[DFT_REG_RDX], dst1_tag, tmp_tag, 8, tid);
+  tag_combine_v(RTAG[DFT_REG_RAX], dst2_tag, tmp_tag, 8, tid);
 }
 
 static void PIN_FAST_ANALYSIS_CALL r2r_unitary_opl(THREADID tid, uint32_t src) {
@@ -48,10 +46,8 @@ static void PIN_FAST_ANALYSIS_CALL r2r_unitary_opl(THREADID tid, uint32_t src) {
   tag_t dst1_tag[] = R32TAG(DFT_REG_RDX);
   tag_t dst2_tag[] = R32TAG(DFT_REG_RAX);
 
-  for (size_t i = 0; i < 4; i++) {
-    RTAG[DFT_REG_RDX][i] = tag_combine(dst1_tag[i], tmp_tag[i],tid);
-    RTAG[DFT_REG_RAX][i] = tag_combine(dst2_tag[i], tmp_tag[i],tid);
-  }
+  tag_combine_v(RTAG[DFT_REG_RDX], dst1_tag, tmp_tag, 4, tid);
+  tag_combine_v(RTAG[DFT_REG_RAX], dst2_tag, tmp_tag, 4, tid);
 }
 
 static void PIN_FAST_ANALYSIS_CALL m2r_unitary_opb(THREADID tid, ADDRINT src) {
@@ -67,10 +63,8 @@ static void PIN_FAST_ANALYSIS_CALL m2r_unitary_opw(THREADID tid, ADDRINT src) {
   tag_t dst1_tag[] = R16TAG(DFT_REG_RDX);
   tag_t dst2_tag[] = R16TAG(DFT_REG_RAX);
 
-  for (size_t i = 0; i < 2; i++) {
-    RTAG[DFT_REG_RDX][i] = tag_combine(dst1_tag[i], tmp_tag[i],tid);
-    RTAG[DFT_REG_RAX][i] = tag_combine(dst2_tag[i], tmp_tag[i],tid);
-  }
+  tag_combine_v(RTAG[DFT_REG_RDX], dst1_tag, tmp_tag, 2, tid);
+  tag_combine_v(RTAG[DFT_REG_RAX], dst2_tag, tmp_tag, 2, tid);
 }
 
 static void PIN_FAST_ANALYSIS_CALL m2r_unitary_opq(THREADID tid, ADDRINT src) {
@@ -78,10 +72,8 @@ static void PIN_FAST_ANALYSIS_CALL m2r_unitary_opq(THREADID tid, ADDRINT src) {
   tag_t dst1_tag[] = R64TAG(DFT_REG_RDX);
   tag_t dst2_tag[] = R64TAG(DFT_REG_RAX);
 
-  for (size_t i = 0; i < 8; i++) {
-    RTAG[DFT_REG_RDX][i] = tag_combine(dst1_tag[i], tmp_tag[i],tid);
-    RTAG[DFT_REG_RAX][i] = tag_combine(dst2_tag[i], tmp_tag[i],tid);
-  }
+  tag_combine_v(RTAG[DFT_REG_RDX], dst1_tag, tmp_tag, 8, tid);
+  tag_combine_v(RTAG[DFT_REG_RAX], dst2_tag, tmp_tag, 8, tid);
 }
 
 static void PIN_FAST_ANALYSIS_CALL m2r_unitary_opl(THREADID tid, ADDRINT src) {
@@ -89,10 +81,8 @@ static void PIN_FAST_ANALYSIS_CALL m2r_unitary_opl(THREADID tid, ADDRINT src) {
   tag_t dst1_tag[] = R32TAG(DFT_REG_RDX);
   tag_t dst2_tag[] = R32TAG(DFT_REG_RAX);
 
-  for (size_t i = 0; i < 4; i++) {
-    RTAG[DFT_REG_RDX][i] = tag_combine(dst1_tag[i], tmp_tag[i],tid);
-    RTAG[DFT_REG_RAX][i] = tag_combine(dst2_tag[i], tmp_tag[i],tid);
-  }
+  tag_combine_v(RTAG[DFT_REG_RDX], dst1_tag, tmp_tag, 4, tid);
+  tag_combine_v(RTAG[DFT_REG_RAX], dst2_tag, tmp_tag, 4, tid);
 }
 
 void ins_unitary_op(INS ins) {
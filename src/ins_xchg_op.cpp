@@ -407,20 +407,18 @@ static void PIN_FAST_ANALYSIS_CALL _xadd_r2r_opl(THREADID tid, uint32_t dst,
                                                  uint32_t src) {
   tag_t dst_tag[] = R32TAG(dst);
   tag_t src_tag[] = R32TAG(src);
-  for (size_t i = 0; i < 4; i++) {
-    RTAG[dst][i] = tag_combine(dst_tag[i], src_tag[i],tid);
+  tag_combine_v(RTAG[dst], dst_tag, src_tag, 4, tid);
+  for (size_t i = 0; i < 4; i++)
     RTAG[src][i] = dst_tag[i];
-  }
 }
 
 static void PIN_FAST_ANALYSIS_CALL _xadd_r2r_opq(THREADID tid, uint32_t dst,
                                                  uint32_t src) {
   tag_t dst_tag[] = R64TAG(dst);
   tag_t src_tag[] = R64TAG(src);
-  for (size_t i = 0; i < 8; i++) {
-    RTAG[dst][i] = tag_combine(dst_tag[i], src_tag[i],tid);
+  tag_combine_v(RTAG[dst], dst_tag, src_tag, 8, tid);
+  for (size_t i = 0; i < 8; i++)
     RTAG[src][i] = dst_tag[i];
-  }
 }
 
 static void PIN_FAST_ANALYSIS_CALL _xadd_r2m_opb_u(THREADID tid, ADDRINT dst,
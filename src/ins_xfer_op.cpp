@@ -87,32 +87,37 @@ void PIN_FAST_ANALYSIS_CALL m2r_xfer_opb_l(THREADID tid, uint32_t dst,
 
 void PIN_FAST_ANALYSIS_CALL m2r_xfer_opw(THREADID tid, uint32_t dst,
                                          ADDRINT src) {
-  for (size_t i = 0; i < 2; i++)
-    RTAG[dst][i] = MTAG(src + i);
+  if (tagmap_range_clean(src, 2) && RTAG_CLEAN(dst, 2))
+    return;
+  tagmap_getw(src, 2, RTAG[dst]);
 }
 
 void PIN_FAST_ANALYSIS_CALL m2r_xfer_opl(THREADID tid, uint32_t dst,
                                          ADDRINT src) {
-  for (size_t i = 0; i < 4; i++)
-    RTAG[dst][i] = MTAG(src + i);
+  if (tagmap_range_clean(src, 4) && RTAG_CLEAN(dst, 4))
+    return;
+  tagmap_getw(src, 4, RTAG[dst]);
 }
 
 void PIN_FAST_ANALYSIS_CALL m2r_xfer_opq(THREADID tid, uint32_t dst,
                                          ADDRINT src) {
-  for (size_t i = 0; i < 8; i++)
-    RTAG[dst][i] = MTAG(src + i);
+  if (tagmap_range_clean(src, 8) && RTAG_CLEAN(dst, 8))
+    return;
+  tagmap_getw(src, 8, RTAG[dst]);
 }
 
 void PIN_FAST_ANALYSIS_CALL m2r_xfer_opx(THREADID tid, uint32_t dst,
                                          ADDRINT src) {
-  for (size_t i = 0; i < 16; i++)
-    RTAG[dst][i] = MTAG(src + i);
+  if (tagmap_range_clean(src, 16) && RTAG_CLEAN(dst, 16))
+    return;
+  tagmap_getw(src, 16, RTAG[dst]);
 }
 
 void PIN_FAST_ANALYSIS_CALL m2r_xfer_opy(THREADID tid, uint32_t dst,
                                          ADDRINT src) {
-  for (size_t i = 0; i < 32; i++)
-    RTAG[dst][i] = MTAG(src + i);
+  if (tagmap_range_clean(src, 32) && RTAG_CLEAN(dst, 32))
+    return;
+  tagmap_getw(src, 32, RTAG[dst]);
 }
 
 void PIN_FAST_ANALYSIS_CALL r2m_xfer_opb_u(THREADID tid, ADDRINT dst,
@@ -131,42 +136,47 @@ void PIN_FAST_ANALYSIS_CALL r2m_xfer_opb_l(THREADID tid, ADDRINT dst,
 
 void PIN_FAST_ANALYSIS_CALL r2m_xfer_opw(THREADID tid, ADDRINT dst,
                                          uint32_t src) {
+  if (RTAG_CLEAN(src, 2) && tagmap_range_clean(dst, 2))
+    return;
   tag_t *src_tags = RTAG[src];
 
-  tagmap_setb(dst, src_tags[0]);
-  tagmap_setb(dst + 1, src_tags[1]);
+  tagmap_setw(dst, 2, src_tags);
 }
 
 void PIN_FAST_ANALYSIS_CALL r2m_xfer_opl(THREADID tid, ADDRINT dst,
                                          uint32_t src) {
+  if (RTAG_CLEAN(src, 4) && tagmap_range_clean(dst, 4))
+    return;
   tag_t *src_tags = RTAG[src];
 
-  for (size_t i = 0; i < 4; i++)
-    tagmap_setb(dst + i, src_tags[i]);
+  tagmap_setw(dst, 4, src_tags);
 }
 
 void PIN_FAST_ANALYSIS_CALL r2m_xfer_opq(THREADID tid, ADDRINT dst,
                                          uint32_t src) {
+  if (RTAG_CLEAN(src, 8) && tagmap_range_clean(dst, 8))
+    return;
   tag_t *src_tags = RTAG[src];
 
-  for (size_t i = 0; i < 8; i++)
-    tagmap_setb(dst + i, src_tags[i]);
+  tagmap_setw(dst, 8, src_tags);
 }
 
 void PIN_FAST_ANALYSIS_CALL r2m_xfer_opx(THREADID tid, ADDRINT dst,
                                          uint32_t src) {
+  if (RTAG_CLEAN(src, 16) && tagmap_range_clean(dst, 16))
+    return;
   tag_t *src_tags = RTAG[src];
 
-  for (size_t i = 0; i < 16; i++)
-    tagmap_setb(dst + i, src_tags[i]);
+  tagmap_setw(dst, 16, src_tags);
 }
 
 void PIN_FAST_ANALYSIS_CALL r2m_xfer_opy(THREADID tid, ADDRINT dst,
                                          uint32_t src) {
+  if (RTAG_CLEAN(src, 32) && tagmap_range_clean(dst, 32))
+    return;
   tag_t *src_tags = RTAG[src];
 
-  for (size_t i = 0; i < 32; i++)
-    tagmap_setb(dst + i, src_tags[i]);
+  tagmap_setw(dst, 32, src_tags);
 }
 
 void PIN_FAST_ANALYSIS_CALL m2m_xfer_opb(ADDRINT dst, ADDRINT src) {
@@ -176,32 +186,46 @@ void PIN_FAST_ANALYSIS_CALL m2m_xfer_opb(ADDRINT dst, ADDRINT src) {
 }
 
 void PIN_FAST_ANALYSIS_CALL m2m_xfer_opw(ADDRINT dst, ADDRINT src) {
-  for (size_t i = 0; i < 2; i++)
-    tagmap_setb(dst + i, MTAG(src + i));
+  if (tagmap_range_clean(src, 2) && tagmap_range_clean(dst, 2))
+    return;
+  tag_t src_tags[2];
+
+  tagmap_getw(src, 2, src_tags);
+  tagmap_setw(dst, 2, src_tags);
 }
 
 void PIN_FAST_ANALYSIS_CALL m2m_xfer_opl(ADDRINT dst, ADDRINT src) {
-  for (size_t i = 0; i < 4; i++)
-    tagmap_setb(dst + i, MTAG(src + i));
+  if (tagmap_range_clean(src, 4) && tagmap_range_clean(dst, 4))
+    return;
+  tag_t src_tags[4];
+
+  tagmap_getw(src, 4, src_tags);
+  tagmap_setw(dst, 4, src_tags);
 }
 
 void PIN_FAST_ANALYSIS_CALL m2m_xfer_opq(ADDRINT dst, ADDRINT src) {
-  for (size_t i = 0; i < 8; i++)
-    tagmap_setb(dst + i, MTAG(src + i));
+  if (tagmap_range_clean(src, 8) && tagmap_range_clean(dst, 8))
+    return;
+  tag_t src_tags[8];
+
+  tagmap_getw(src, 8, src_tags);
+  tagmap_setw(dst, 8, src_tags);
 }
 
 void PIN_FAST_ANALYSIS_CALL m2r_xfer_opq_h(THREADID tid, uint32_t dst,
                                            ADDRINT src) {
-  for (size_t i = 0; i < 8; i++)
-    RTAG[dst][i + 8] = MTAG(src + i);
+  if (tagmap_range_clean(src, 8) && rtag_clean(RTAG[dst] + 8, 8))
+    return;
+  tagmap_getw(src, 8, RTAG[dst] + 8);
 }
 
 void PIN_FAST_ANALYSIS_CALL r2m_xfer_opq_h(THREADID tid, ADDRINT dst,
                                            uint32_t src) {
+  if (rtag_clean(RTAG[src] + 8, 8) && tagmap_range_clean(dst, 8))
+    return;
   tag_t *src_tags = RTAG[src];
 
-  for (size_t i = 0; i < 8; i++)
-    tagmap_setb(dst + i, src_tags[i + 8]);
+  tagmap_setw(dst, 8, src_tags + 8);
 }
 
 static void PIN_FAST_ANALYSIS_CALL r2m_xfer_opbn(THREADID tid, ADDRINT dst,
@@ -210,15 +234,10 @@ static void PIN_FAST_ANALYSIS_CALL r2m_xfer_opbn(THREADID tid, ADDRINT dst,
   tag_t src_tag = RTAG[DFT_REG_RAX][0];
   if (likely(EFLAGS_DF(eflags) == 0)) {
     /* EFLAGS.DF = 0 */
-    for (size_t i = 0; i < count; i++) {
-      tagmap_setb(dst + i, src_tag);
-    }
+    tagmap_setn(dst, count, src_tag);
   } else {
     /* EFLAGS.DF = 1 */
-    for (size_t i = 0; i < count; i++) {
-      size_t dst_addr = dst - count + 1 + i;
-      tagmap_setb(dst_addr, src_tag);
-    }
+    tagmap_setn(dst - count + 1, count, src_tag);
   }
 }
 
@@ -283,20 +302,17 @@ static ADDRINT PIN_FAST_ANALYSIS_CALL rep_predicate(BOOL first_iteration) {
 
 static void PIN_FAST_ANALYSIS_CALL _lea_opw(THREADID tid, uint32_t dst,
                                             uint32_t base, uint32_t index) {
-  for (size_t i = 0; i < 2; i++)
-    RTAG[dst][i] = tag_combine(RTAG[base][i], RTAG[index][i],tid);
+  tag_combine_v(RTAG[dst], RTAG[base], RTAG[index], 2, tid);
 }
 
 static void PIN_FAST_ANALYSIS_CALL _lea_opl(THREADID tid, uint32_t dst,
                                             uint32_t base, uint32_t index) {
-  for (size_t i = 0; i < 4; i++)
-    RTAG[dst][i] = tag_combine(RTAG[base][i], RTAG[index][i],tid);
+  tag_combine_v(RTAG[dst], RTAG[base], RTAG[index], 4, tid);
 }
 
 static void PIN_FAST_ANALYSIS_CALL _lea_opq(THREADID tid, uint32_t dst,
                                             uint32_t base, uint32_t index) {
-  for (size_t i = 0; i < 8; i++)
-    RTAG[dst][i] = tag_combine(RTAG[base][i], RTAG[index][i],tid);
+  tag_combine_v(RTAG[dst], RTAG[base], RTAG[index], 8, tid);
 }
 
 void ins_xfer_op(INS ins) {
@@ -539,41 +555,63 @@ void ins_lea(INS ins) {
 
 void PIN_FAST_ANALYSIS_CALL m2r_xfer_opw_rev(THREADID tid, uint32_t dst,
                                              ADDRINT src) {
+  if (tagmap_range_clean(src, 2) && RTAG_CLEAN(dst, 2))
+    return;
+  tag_t src_tags[2];
+
+  tagmap_getw(src, 2, src_tags);
   for (size_t i = 0; i < 2; i++)
-    RTAG[dst][i] = MTAG(src + (1 - i));
+    RTAG[dst][i] = src_tags[1 - i];
 }
 
 void PIN_FAST_ANALYSIS_CALL m2r_xfer_opl_rev(THREADID tid, uint32_t dst,
                                              ADDRINT src) {
+  if (tagmap_range_clean(src, 4) && RTAG_CLEAN(dst, 4))
+    return;
+  tag_t src_tags[4];
+
+  tagmap_getw(src, 4, src_tags);
   for (size_t i = 0; i < 4; i++)
-    RTAG[dst][i] = MTAG(src + (3 - i));
+    RTAG[dst][i] = src_tags[3 - i];
 }
 
 void PIN_FAST_ANALYSIS_CALL m2r_xfer_opq_rev(THREADID tid, uint32_t dst,
                                              ADDRINT src) {
+  if (tagmap_range_clean(src, 8) && RTAG_CLEAN(dst, 8))
+    return;
+  tag_t src_tags[8];
+
+  tagmap_getw(src, 8, src_tags);
   for (size_t i = 0; i < 8; i++)
-    RTAG[dst][i] = MTAG(src + (7 - i));
+    RTAG[dst][i] = src_tags[7 - i];
 }
 
 void PIN_FAST_ANALYSIS_CALL r2m_xfer_opw_rev(THREADID tid, ADDRINT dst,
                                              uint32_t src) {
-  tag_t *src_tags = RTAG[src];
-  tagmap_setb(dst, src_tags[1]);
-  tagmap_setb(dst + 1, src_tags[0]);
+  if (RTAG_CLEAN(src, 2) && tagmap_range_clean(dst, 2))
+    return;
+  tag_t dst_tags[] = {RTAG[src][1], RTAG[src][0]};
+  tagmap_setw(dst, 2, dst_tags);
 }
 
 void PIN_FAST_ANALYSIS_CALL r2m_xfer_opl_rev(THREADID tid, ADDRINT dst,
                                              uint32_t src) {
-  tag_t *src_tags = RTAG[src];
+  if (RTAG_CLEAN(src, 4) && tagmap_range_clean(dst, 4))
+    return;
+  tag_t dst_tags[4];
   for (size_t i = 0; i < 4; i++)
-    tagmap_setb(dst + (3 - i), src_tags[i]);
+    dst_tags[3 - i] = RTAG[src][i];
+  tagmap_setw(dst, 4, dst_tags);
 }
 
 void PIN_FAST_ANALYSIS_CALL r2m_xfer_opq_rev(THREADID tid, ADDRINT dst,
                                              uint32_t src) {
-  tag_t *src_tags = RTAG[src];
+  if (RTAG_CLEAN(src, 8) && tagmap_range_clean(dst, 8))
+    return;
+  tag_t dst_tags[8];
   for (size_t i = 0; i < 8; i++)
-    tagmap_setb(dst + (7 - i), src_tags[i]);
+    dst_tags[7 - i] = RTAG[src][i];
+  tagmap_setw(dst, 8, dst_tags);
 }
 
 void ins_movbe_op(INS ins) {
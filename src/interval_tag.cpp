@@ -0,0 +1,189 @@
+#include "interval_tag.h"
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+extern FILE *log_fd;
+void libdft_die(void);
+
+/*
+ * the interval arena: spilled interval lists have power-of-two capacities,
+ * and freed blocks of each capacity are kept on a free list instead of
+ * going back to malloc, since tags are copied and dropped on every
+ * instruction. Larger blocks use malloc directly
+ */
+static interval_t *arena_free[INTERVAL_ARENA_CLASSES];
+static size_t arena_n[INTERVAL_ARENA_CLASSES];
+static volatile int arena_lock;
+
+static inline int arena_class(uint32_t cap) {
+  return __builtin_ctz(cap / INTERVAL_ARENA_MIN);
+}
+
+static interval_t *interval_arena_alloc(uint32_t cap) {
+  int c = arena_class(cap);
+  interval_t *p = NULL;
+  if (c < INTERVAL_ARENA_CLASSES) {
+    while (__sync_lock_test_and_set(&arena_lock, 1))
+      ;
+    p = arena_free[c];
+    if (p != NULL) {
+      memcpy(&arena_free[c], p, sizeof(interval_t *));
+      arena_n[c]--;
+    }
+    __sync_lock_release(&arena_lock);
+  }
+  if (p == NULL) {
+    p = (interval_t *)malloc(sizeof(interval_t) * cap);
+    if (p == NULL) {
+      fprintf(log_fd, "interval arena: out of memory\n");
+      libdft_die();
+      abort(); /* libdft_die() only detaches; there is no block to return */
+    }
+  }
+  return p;
+}
+
+static void interval_arena_free(interval_t *p, uint32_t cap) {
+  int c = arena_class(cap);
+  if (c < INTERVAL_ARENA_CLASSES) {
+    while (__sync_lock_test_and_set(&arena_lock, 1))
+      ;
+    if (arena_n[c] < INTERVAL_ARENA_KEEP) {
+      memcpy(p, &arena_free[c], sizeof(interval_t *));
+      arena_free[c] = p;
+      arena_n[c]++;
+      p = NULL;
+    }
+    __sync_lock_release(&arena_lock);
+  }
+  if (p != NULL)
+    free(p);
+}
+
+void IntervalTag::reserve(uint32_t need) {
+  if (need <= cap)
+    return;
+  uint32_t c = INTERVAL_ARENA_MIN;
+  while (c < need)
+    c <<= 1;
+  interval_t *p = interval_arena_alloc(c);
+  memcpy(p, buf(), sizeof(interval_t) * n);
+  release();
+  heap = p;
+  cap = c;
+}
+
+void IntervalTag::release() {
+  if (cap != INTERVAL_INLINE)
+    interval_arena_free(heap, cap);
+  cap = INTERVAL_INLINE;
+}
+
+IntervalTag::IntervalTag(const IntervalTag &rhs) : n(0), cap(INTERVAL_INLINE) {
+  reserve(rhs.n);
+  memcpy(buf(), rhs.data(), sizeof(interval_t) * rhs.n);
+  n = rhs.n;
+}
+
+IntervalTag::IntervalTag(IntervalTag &&rhs) : n(rhs.n), cap(rhs.cap) {
+  if (cap == INTERVAL_INLINE)
+    memcpy(inl, rhs.inl, sizeof(interval_t) * n);
+  else
+    heap = rhs.heap;
+  rhs.n = 0;
+  rhs.cap = INTERVAL_INLINE;
+}
+
+IntervalTag &IntervalTag::operator=(const IntervalTag &rhs) {
+  if (this == &rhs)
+    return *this;
+  n = 0;
+  reserve(rhs.n);
+  memcpy(buf(), rhs.data(), sizeof(interval_t) * rhs.n);
+  n = rhs.n;
+  return *this;
+}
+
+IntervalTag &IntervalTag::operator=(IntervalTag &&rhs) {
+  if (this == &rhs)
+    return *this;
+  release();
+  n = rhs.n;
+  cap = rhs.cap;
+  if (cap == INTERVAL_INLINE)
+    memcpy(inl, rhs.inl, sizeof(interval_t) * n);
+  else
+    heap = rhs.heap;
+  rhs.n = 0;
+  rhs.cap = INTERVAL_INLINE;
+  return *this;
+}
+
+bool IntervalTag::operator==(const IntervalTag &rhs) const {
+  return n == rhs.n &&
+         memcmp(data(), rhs.data(), sizeof(interval_t) * n) == 0;
+}
+
+// Two-pointer merge of the sorted lists, coalescing as it appends; the
+// result only spills when it has more than INTERVAL_INLINE intervals.
+IntervalTag IntervalTag::merge(IntervalTag const &a, IntervalTag const &b) {
+  if (b.n == 0 || &a == &b)
+    return a;
+  if (a.n == 0)
+    return b;
+  interval_t const *x = a.data(), *y = b.data();
+  IntervalTag res;
+  uint32_t i = 0, j = 0;
+  while (i < a.n || j < b.n) {
+    interval_t const &next =
+        (j == b.n || (i < a.n && x[i].begin <= y[j].begin)) ? x[i++] : y[j++];
+    res.append(next.begin, next.end);
+  }
+  return res;
+}
+
+// All intervals of the inputs sorted by begin and coalesced in one pass.
+IntervalTag IntervalTag::merge_n(IntervalTag const *tags, size_t count) {
+  size_t total = 0, nonempty = 0, last = 0;
+  for (size_t i = 0; i < count; i++) {
+    if (tags[i].n == 0)
+      continue;
+    total += tags[i].n;
+    nonempty++;
+    last = i;
+  }
+  if (nonempty == 0)
+    return IntervalTag();
+  if (nonempty == 1)
+    return tags[last];
+
+  std::vector<interval_t> all;
+  all.reserve(total);
+  for (size_t i = 0; i < count; i++)
+    all.insert(all.end(), tags[i].data(), tags[i].data() + tags[i].n);
+  std::sort(all.begin(), all.end(),
+            [](interval_t const &l, interval_t const &r) {
+              return l.begin < r.begin;
+            });
+  IntervalTag res;
+  for (size_t i = 0; i < all.size(); i++)
+    res.append(all[i].begin, all[i].end);
+  return res;
+}
+
+std::string IntervalTag::to_string() const {
+  std::string ss = "";
+  ss += "{";
+  char buf[100];
+  interval_t const *p = data();
+  for (uint32_t i = 0; i < n; i++) {
+    sprintf(buf, "(%u, %u) ", p[i].begin, p[i].end);
+    std::string s(buf);
+    ss += s;
+  }
+  ss += "}";
+  return ss;
+}
@@ -0,0 +1,82 @@
+//! Implements a tag as a sorted list of disjoint offset intervals.
+
+#ifndef INTERVAL_TAG_H
+#define INTERVAL_TAG_H
+
+#include <stdint.h>
+#include <string>
+
+#define INTERVAL_INLINE 4     /* intervals stored in the tag itself */
+#define INTERVAL_ARENA_MIN 8  /* smallest spilled capacity */
+#define INTERVAL_ARENA_CLASSES 12 /* spilled capacities kept for reuse: 8 .. 16K */
+#define INTERVAL_ARENA_KEEP 256   /* free blocks kept per capacity */
+
+struct interval_t {
+  uint32_t begin;
+  uint32_t end; /* exclusive */
+};
+
+/*
+ * a set of input offsets as sorted, disjoint and non-adjacent [begin, end)
+ * intervals. Up to INTERVAL_INLINE intervals are kept inline; longer lists
+ * spill to blocks of the interval arena (interval_tag.cpp)
+ */
+class IntervalTag {
+private:
+  uint32_t n;
+  uint32_t cap; /* INTERVAL_INLINE while inline */
+  union {
+    interval_t inl[INTERVAL_INLINE];
+    interval_t *heap;
+  };
+
+  interval_t *buf() { return cap == INTERVAL_INLINE ? inl : heap; }
+  void reserve(uint32_t need);
+  void release();
+
+public:
+  IntervalTag() : n(0), cap(INTERVAL_INLINE) {}
+  IntervalTag(uint32_t begin, uint32_t end) : n(0), cap(INTERVAL_INLINE) {
+    append(begin, end);
+  }
+  IntervalTag(const IntervalTag &rhs);
+  IntervalTag(IntervalTag &&rhs);
+  ~IntervalTag() { release(); }
+  IntervalTag &operator=(const IntervalTag &rhs);
+  IntervalTag &operator=(IntervalTag &&rhs);
+  bool operator==(const IntervalTag &rhs) const;
+
+  bool empty() const { return n == 0; }
+  uint32_t size() const { return n; }
+  interval_t const *data() const { return cap == INTERVAL_INLINE ? inl : heap; }
+  void clear() { n = 0; }
+
+  /*
+   * add [begin, end) after the current intervals; begin must not be less
+   * than the begin of the last one. Overlapping or adjacent intervals are
+   * coalesced
+   */
+  void append(uint32_t begin, uint32_t end) {
+    if (begin >= end)
+      return;
+    interval_t *b = buf();
+    if (n > 0 && begin <= b[n - 1].end) {
+      if (end > b[n - 1].end)
+        b[n - 1].end = end;
+      return;
+    }
+    if (n == cap) {
+      reserve(n + 1);
+      b = buf();
+    }
+    b[n].begin = begin;
+    b[n].end = end;
+    n++;
+  }
+
+  static IntervalTag merge(IntervalTag const &a, IntervalTag const &b);
+  static IntervalTag merge_n(IntervalTag const *tags, size_t count);
+  std::string to_string() const;
+};
+
+#endif // INTERVAL_TAG_H
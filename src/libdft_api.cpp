@@ -37,6 +37,7 @@
 #include "syscall_desc.h"
 #include "syscall_hook.h"
 #include "ssa_tag.h"
+#include "ins_helper.h"
 #include "fcntl.h"
 /* threads context counter */
 size_t tctx_ct = 0;
@@ -219,6 +220,143 @@ static void sysexit_save(THREADID tid, CONTEXT *ctx, SYSCALL_STANDARD std,
   }
 }
 
+/*
+ * trace versions
+ *
+ * every trace is compiled twice: TRACE_VER_FULL carries the complete
+ * tag propagation, TRACE_VER_CLEAN only the checks that decide whether
+ * it is still safe to skip it. execution starts in TRACE_VER_FULL and
+ * switches to TRACE_VER_CLEAN at the head of a trace whose registers
+ * are all clean; the clean version falls back at the head of a trace
+ * whose registers are not, or before the first instruction that
+ * touches tainted memory
+ */
+#define TRACE_VER_FULL 0
+#define TRACE_VER_CLEAN 1
+
+/* tool register carrying the version switch condition */
+static REG trace_ver_reg;
+
+/* helper registers are scratch space of the handlers; always checked */
+#define TRACE_REGS_HELPER                                                      \
+  ((1ULL << DFT_REG_HELPER1) | (1ULL << DFT_REG_HELPER2) |                     \
+   (1ULL << DFT_REG_HELPER3))
+
+/*
+ * check that none of the registers in @mask carries a tag
+ *
+ * @tid:	the thread id
+ * @mask:	bitmap of register indices (REG_INDX)
+ *
+ * returns: 1 if all of them are clean, 0 otherwise
+ */
+static ADDRINT PIN_FAST_ANALYSIS_CALL trace_regs_clean(THREADID tid,
+                                                       ADDRINT mask) {
+  while (mask) {
+    unsigned int r = __builtin_ctzll(mask);
+    if (!rtag_clean(threads_ctx[tid].vcpu.gpr[r], TAGS_PER_GPR))
+      return 0;
+    mask &= mask - 1;
+  }
+  return 1;
+}
+
+/*
+ * fold one memory operand into the switch condition
+ *
+ * @clean:	condition so far
+ * @addr:	effective address of the operand
+ * @size:	size of the operand
+ *
+ * returns: 1 if the condition holds and the operand is clean
+ */
+static ADDRINT PIN_FAST_ANALYSIS_CALL trace_mem_clean(ADDRINT clean,
+                                                      ADDRINT addr,
+                                                      UINT32 size) {
+  return clean & tagmap_range_clean(addr, size);
+}
+
+/* the condition for instructions the clean version cannot reason about */
+static ADDRINT PIN_FAST_ANALYSIS_CALL trace_never_clean(void) { return 0; }
+
+/*
+ * instructions whose touched memory cannot be described by their
+ * memory operands (REP strings, gathers/scatters, xsave, ...)
+ */
+static inline bool trace_ins_opaque(INS ins) {
+  return INS_HasRealRep(ins) ||
+         (INS_MemoryOperandCount(ins) > 0 && !INS_IsStandardMemop(ins));
+}
+
+/* fold the memory operands of @ins into trace_ver_reg, seeded by @seed */
+static inline void trace_ins_mem_check(INS ins, bool seed) {
+  for (UINT32 i = 0; i < INS_MemoryOperandCount(ins); i++) {
+    if (seed && i == 0)
+      INS_InsertCall(ins, IPOINT_BEFORE, (AFUNPTR)trace_mem_clean,
+                     IARG_FAST_ANALYSIS_CALL, IARG_ADDRINT, (ADDRINT)1,
+                     IARG_MEMORYOP_EA, i, IARG_UINT32,
+                     INS_MemoryOperandSize(ins, i), IARG_RETURN_REGS,
+                     trace_ver_reg, IARG_END);
+    else
+      INS_InsertCall(ins, IPOINT_BEFORE, (AFUNPTR)trace_mem_clean,
+                     IARG_FAST_ANALYSIS_CALL, IARG_REG_VALUE, trace_ver_reg,
+                     IARG_MEMORYOP_EA, i, IARG_UINT32,
+                     INS_MemoryOperandSize(ins, i), IARG_RETURN_REGS,
+                     trace_ver_reg, IARG_END);
+  }
+}
+
+/*
+ * collect every register (explicit or implicit) the trace reads or
+ * writes; a clean version may only run if all of them are clean, as
+ * skipping a write would leave a stale tag behind
+ */
+static ADDRINT trace_regs_mask(TRACE trace) {
+  ADDRINT mask = TRACE_REGS_HELPER;
+  for (BBL bbl = TRACE_BblHead(trace); BBL_Valid(bbl); bbl = BBL_Next(bbl))
+    for (INS ins = BBL_InsHead(bbl); INS_Valid(ins); ins = INS_Next(ins)) {
+      for (UINT32 i = 0; i < INS_MaxNumRRegs(ins); i++)
+        mask |= 1ULL << REG_INDX(INS_RegR(ins, i));
+      for (UINT32 i = 0; i < INS_MaxNumWRegs(ins); i++)
+        mask |= 1ULL << REG_INDX(INS_RegW(ins, i));
+    }
+  /* GRP_NUM is the catch-all for untracked registers */
+  return mask & ~(1ULL << GRP_NUM);
+}
+
+/*
+ * invoke the pre/post instrumentation callbacks of @ins, and the tag
+ * propagation in between if @full is set
+ */
+static inline void trace_ins_inspect(INS ins, bool full) {
+  /*
+   * use XED to decode the instruction and
+   * extract its opcode
+   */
+  xed_iclass_enum_t ins_indx = (xed_iclass_enum_t)INS_Opcode(ins);
+
+  /*
+   * invoke the pre-ins insrumentation callback;
+   * optimized branch
+   */
+  if (unlikely(ins_desc[ins_indx].pre != NULL))
+    ins_desc[ins_indx].pre(ins);
+
+  /* analyze the instruction */
+  /*
+  if (is_tainted())
+    LOGD("[ins] %s\n", INS_Disassemble(ins).c_str());
+  */
+  if (full)
+    ins_inspect(ins);
+  /*
+   * invoke the post-ins insrumentation callback;
+   * optimized branch
+   */
+  if (unlikely(ins_desc[ins_indx].post != NULL))
+    ins_desc[ins_indx].post(ins);
+}
+
 /*
  * trace inspection (instrumentation function)
  *
@@ -232,44 +370,69 @@ static void trace_inspect(TRACE trace, VOID *v) {
   /* iterators */
   BBL bbl;
   INS ins;
-  xed_iclass_enum_t ins_indx;
+  INS head = BBL_InsHead(TRACE_BblHead(trace));
+
+  if (TRACE_Version(trace) == TRACE_VER_CLEAN) {
+    /*
+     * Pin keeps the version across traces, so the registers checked
+     * when switching in only cover the first clean trace: every clean
+     * trace checks its own registers at the head, together with the
+     * memory of the head. memory is checked right before every other
+     * instruction that touches it
+     */
+    for (bbl = TRACE_BblHead(trace); BBL_Valid(bbl); bbl = BBL_Next(bbl))
+      for (ins = BBL_InsHead(bbl); INS_Valid(ins); ins = INS_Next(ins)) {
+        if (ins == head) {
+          INS_InsertCall(ins, IPOINT_BEFORE, (AFUNPTR)trace_regs_clean,
+                         IARG_FAST_ANALYSIS_CALL, IARG_THREAD_ID,
+                         IARG_ADDRINT, trace_regs_mask(trace),
+                         IARG_RETURN_REGS, trace_ver_reg, IARG_END);
+          if (unlikely(trace_ins_opaque(ins)))
+            INS_InsertCall(ins, IPOINT_BEFORE, (AFUNPTR)trace_never_clean,
+                           IARG_FAST_ANALYSIS_CALL, IARG_RETURN_REGS,
+                           trace_ver_reg, IARG_END);
+          else
+            trace_ins_mem_check(ins, false);
+          INS_InsertVersionCase(ins, trace_ver_reg, 0, TRACE_VER_FULL,
+                                IARG_END);
+        } else if (unlikely(trace_ins_opaque(ins))) {
+          INS_InsertCall(ins, IPOINT_BEFORE, (AFUNPTR)trace_never_clean,
+                         IARG_FAST_ANALYSIS_CALL, IARG_RETURN_REGS,
+                         trace_ver_reg, IARG_END);
+          INS_InsertVersionCase(ins, trace_ver_reg, 0, TRACE_VER_FULL,
+                                IARG_END);
+        } else if (INS_MemoryOperandCount(ins) > 0) {
+          trace_ins_mem_check(ins, true);
+          INS_InsertVersionCase(ins, trace_ver_reg, 0, TRACE_VER_FULL,
+                                IARG_END);
+        }
+        trace_ins_inspect(ins, false);
+      }
+    return;
+  }
+
+  /*
+   * switch to the clean version at the head; the condition includes
+   * the memory operands of the head so that the clean version never
+   * bounces straight back. opaque heads stay in this version
+   */
+  if (INS_Valid(head) && !trace_ins_opaque(head)) {
+    INS_InsertCall(head, IPOINT_BEFORE, (AFUNPTR)trace_regs_clean,
+                   IARG_FAST_ANALYSIS_CALL, IARG_THREAD_ID, IARG_ADDRINT,
+                   trace_regs_mask(trace), IARG_RETURN_REGS, trace_ver_reg,
+                   IARG_END);
+    trace_ins_mem_check(head, false);
+    INS_InsertVersionCase(head, trace_ver_reg, 1, TRACE_VER_CLEAN, IARG_END);
+  }
 
   /* traverse all the BBLs in the trace */
   for (bbl = TRACE_BblHead(trace); BBL_Valid(bbl); bbl = BBL_Next(bbl)) {
     /* traverse all the instructions in the BBL */
-    for (ins = BBL_InsHead(bbl); INS_Valid(ins); ins = INS_Next(ins)) {
-      // if (!is_tainted())
-      //  continue;
-      /*
-       * use XED to decode the instruction and
-       * extract its opcode
-       */
-      ins_indx = (xed_iclass_enum_t)INS_Opcode(ins);
-
-      /*
-       * invoke the pre-ins insrumentation callback;
-       * optimized branch
-       */
-      if (unlikely(ins_desc[ins_indx].pre != NULL))
-        ins_desc[ins_indx].pre(ins);
-
-      /* analyze the instruction */
-      /*
-      if (is_tainted())
-        LOGD("[ins] %s\n", INS_Disassemble(ins).c_str());
-      */
-      ins_inspect(ins);
-      /*
-       * invoke the post-ins insrumentation callback;
-       * optimized branch
-       */
-      if (unlikely(ins_desc[ins_indx].post != NULL))
-        ins_desc[ins_indx].post(ins);
-    }
+    for (ins = BBL_InsHead(bbl); INS_Valid(ins); ins = INS_Next(ins))
+      trace_ins_inspect(ins, true);
   }
 }
 
-
 FILE *log_fd;
 int fifo_fd;
 #ifdef TAINT_PROFILE
@@ -380,6 +543,12 @@ int libdft_init() {
   /* initialize the ins descriptors */
   (void)memset(ins_desc, 0, sizeof(ins_desc));
 
+  /* scratch register for switching between trace versions */
+  trace_ver_reg = PIN_ClaimToolRegister();
+  if (unlikely(!REG_valid(trace_ver_reg)))
+    /* no tool register left */
+    return 1;
+
   /* register trace_ins() to be called for every trace */
   TRACE_AddInstrumentFunction(trace_inspect, NULL);
 #if defined(SSA_PROFILE) || defined(TAINT_PROFILE) || defined(TAINT_COUNT)
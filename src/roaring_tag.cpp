@@ -0,0 +1,550 @@
+#include "roaring_tag.h"
+#include "tag_bits.h"
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+extern FILE *log_fd;
+void libdft_die(void);
+
+/*
+ * 256-bit lanes for the bitmap kernels. GCC emits AVX2 for them when the
+ * tool is built with -mavx2 and pairs of SSE2 operations otherwise
+ */
+typedef uint64_t roaring_v4du __attribute__((vector_size(32)));
+
+/* scratch for building one container before it is interned */
+union roaring_buf {
+  uint64_t words[ROARING_WORDS];
+  uint16_t vals[ROARING_ARRAY_MAX];
+  roaring_run runs[ROARING_RUN_MAX];
+};
+
+struct roaring_cache_entry {
+  roaring_set const *a;
+  roaring_set const *b;
+  roaring_set const *res;
+};
+
+/*
+ * the intern tables, the combine cache and the arena behind them share one
+ * spinlock. Unions are computed outside of it, so it is only held for a
+ * lookup and, on a miss, one copy
+ */
+static volatile int roaring_lock;
+static roaring_container *cont_table[1 << ROARING_INTERN_BITS];
+static roaring_set *set_table[1 << ROARING_INTERN_BITS];
+static roaring_cache_entry roaring_cache[1 << ROARING_CACHE_BITS];
+static char *arena_cur;
+static size_t arena_left;
+
+static inline void roaring_lock_acquire() {
+  while (__sync_lock_test_and_set(&roaring_lock, 1))
+    ;
+}
+
+static inline void roaring_lock_release() {
+  __sync_lock_release(&roaring_lock);
+}
+
+/* interned objects are never freed, so they are carved out of big chunks */
+static void *roaring_arena_alloc(size_t size) {
+  size = (size + 7) & ~(size_t)7;
+  if (size > arena_left) {
+    size_t chunk = size > ROARING_ARENA_CHUNK ? size : ROARING_ARENA_CHUNK;
+    arena_cur = (char *)malloc(chunk);
+    if (arena_cur == NULL) {
+      fprintf(log_fd, "roaring arena: out of memory\n");
+      libdft_die();
+      abort(); /* libdft_die() only detaches; there is no block to return */
+    }
+    arena_left = chunk;
+  }
+  void *p = arena_cur;
+  arena_cur += size;
+  arena_left -= size;
+  return p;
+}
+
+static inline uint64_t roaring_mix(uint64_t h, uint64_t v) {
+  h ^= v;
+  h *= 0x9e3779b97f4a7c15ULL;
+  return h ^ (h >> 29);
+}
+
+static uint64_t roaring_hash(void const *data, size_t bytes, uint64_t h) {
+  unsigned char const *p = (unsigned char const *)data;
+  size_t i = 0;
+  for (; i + 8 <= bytes; i += 8) {
+    uint64_t w;
+    memcpy(&w, p + i, 8);
+    h = roaring_mix(h, w);
+  }
+  if (i < bytes) {
+    uint64_t w = 0;
+    memcpy(&w, p + i, bytes - i);
+    h = roaring_mix(h, w);
+  }
+  return h;
+}
+
+static inline size_t cont_bytes(uint32_t type, uint32_t n) {
+  if (type == ROARING_ARRAY)
+    return n * sizeof(uint16_t);
+  if (type == ROARING_BITMAP)
+    return n * sizeof(uint64_t);
+  return n * sizeof(roaring_run);
+}
+
+static roaring_container const *cont_intern(uint32_t type, void const *data,
+                                            uint32_t n, uint32_t card) {
+  size_t bytes = cont_bytes(type, n);
+  uint64_t h = roaring_hash(data, bytes, roaring_mix(type, n));
+  roaring_container **bucket =
+      &cont_table[h & ((1 << ROARING_INTERN_BITS) - 1)];
+  roaring_lock_acquire();
+  roaring_container *c = *bucket;
+  while (c != NULL && !(c->hash == h && c->type == type && c->n == n &&
+                        memcmp(c + 1, data, bytes) == 0))
+    c = c->next;
+  if (c == NULL) {
+    c = (roaring_container *)roaring_arena_alloc(sizeof(roaring_container) +
+                                                 bytes);
+    c->hash = h;
+    c->type = type;
+    c->n = n;
+    c->card = card;
+    c->pad = 0;
+    memcpy(c + 1, data, bytes);
+    c->next = *bucket;
+    *bucket = c;
+  }
+  roaring_lock_release();
+  return c;
+}
+
+static roaring_set const *set_intern(uint16_t const *keys,
+                                     roaring_container const *const *conts,
+                                     uint32_t n) {
+  if (n == 0)
+    return NULL;
+  size_t cbytes = n * sizeof(roaring_container *);
+  size_t kbytes = n * sizeof(uint16_t);
+  uint64_t h = roaring_hash(keys, kbytes, roaring_hash(conts, cbytes, n));
+  roaring_set **bucket = &set_table[h & ((1 << ROARING_INTERN_BITS) - 1)];
+  roaring_lock_acquire();
+  roaring_set *s = *bucket;
+  while (s != NULL && !(s->hash == h && s->n == n &&
+                        memcmp(s->conts(), conts, cbytes) == 0 &&
+                        memcmp(s->keys(), keys, kbytes) == 0))
+    s = s->next;
+  if (s == NULL) {
+    s = (roaring_set *)roaring_arena_alloc(sizeof(roaring_set) + cbytes +
+                                           kbytes);
+    s->hash = h;
+    s->n = n;
+    s->pad = 0;
+    memcpy((void *)s->conts(), conts, cbytes);
+    memcpy((void *)s->keys(), keys, kbytes);
+    s->next = *bucket;
+    *bucket = s;
+  }
+  roaring_lock_release();
+  return s;
+}
+
+/*
+ * the smallest representation of a container with card values in nruns
+ * runs: 4 bytes per run, 2 per value (up to ROARING_ARRAY_MAX) or 8KB
+ */
+static uint32_t roaring_pick(uint32_t card, uint32_t nruns) {
+  uint32_t run_bytes = nruns * sizeof(roaring_run);
+  uint32_t bmp_bytes = ROARING_WORDS * sizeof(uint64_t);
+  uint32_t arr_bytes =
+      card <= ROARING_ARRAY_MAX ? card * sizeof(uint16_t) : bmp_bytes + 1;
+  if (run_bytes < arr_bytes && run_bytes < bmp_bytes)
+    return ROARING_RUN;
+  return arr_bytes <= bmp_bytes ? ROARING_ARRAY : ROARING_BITMAP;
+}
+
+/* w |= src, 256 bits per step */
+static void words_or(uint64_t *w, uint64_t const *src) {
+  for (size_t i = 0; i < ROARING_WORDS; i += 4) {
+    roaring_v4du a, b;
+    memcpy(&a, w + i, sizeof(a));
+    memcpy(&b, src + i, sizeof(b));
+    a |= b;
+    memcpy(w + i, &a, sizeof(a));
+  }
+}
+
+static void words_add(uint64_t *w, roaring_container const *c) {
+  if (c->type == ROARING_BITMAP) {
+    words_or(w, c->words());
+  } else if (c->type == ROARING_ARRAY) {
+    uint16_t const *v = c->vals();
+    for (uint32_t i = 0; i < c->n; i++)
+      w[v[i] >> 6] |= 1ULL << (v[i] & 63);
+  } else {
+    roaring_run const *r = c->runs();
+    for (uint32_t i = 0; i < c->n; i++)
+      tag_bits_fill(w, r[i].start, (size_t)r[i].last - r[i].start + 1, true);
+  }
+}
+
+/* first position >= pos whose bit equals set, or 2^16 */
+static uint32_t words_next(uint64_t const *w, uint32_t pos, bool set) {
+  uint32_t i = pos >> 6;
+  if (i >= ROARING_WORDS)
+    return ROARING_WORDS * 64;
+  uint64_t x = (set ? w[i] : ~w[i]) & (~0ULL << (pos & 63));
+  while (x == 0) {
+    if (++i == ROARING_WORDS)
+      return ROARING_WORDS * 64;
+    x = set ? w[i] : ~w[i];
+  }
+  return i * 64 + __builtin_ctzll(x);
+}
+
+/* words -> runs; at most ROARING_RUN_MAX of them when called */
+static uint32_t words_to_runs(uint64_t const *w, roaring_run *runs) {
+  uint32_t k = 0, pos = 0, s;
+  while ((s = words_next(w, pos, true)) < ROARING_WORDS * 64) {
+    pos = words_next(w, s, false);
+    runs[k].start = s;
+    runs[k].last = pos - 1;
+    k++;
+  }
+  return k;
+}
+
+static roaring_container const *cont_from_words(uint64_t const *w,
+                                                roaring_buf *out) {
+  uint32_t card = 0, nruns = 0;
+  uint64_t carry = 0;
+  for (size_t i = 0; i < ROARING_WORDS; i++) {
+    /* a run starts at every set bit whose lower neighbour is clear */
+    card += __builtin_popcountll(w[i]);
+    nruns += __builtin_popcountll(w[i] & ~((w[i] << 1) | carry));
+    carry = w[i] >> 63;
+  }
+  switch (roaring_pick(card, nruns)) {
+  case ROARING_ARRAY: {
+    uint32_t k = 0;
+    for (uint32_t i = 0; i < ROARING_WORDS; i++)
+      for (uint64_t x = w[i]; x != 0; x &= x - 1)
+        out->vals[k++] = i * 64 + __builtin_ctzll(x);
+    return cont_intern(ROARING_ARRAY, out->vals, card, card);
+  }
+  case ROARING_RUN:
+    return cont_intern(ROARING_RUN, out->runs, words_to_runs(w, out->runs),
+                       card);
+  default:
+    return cont_intern(ROARING_BITMAP, w, ROARING_WORDS, card);
+  }
+}
+
+/* sorted, distinct values; n is at most ROARING_ARRAY_MAX */
+static roaring_container const *cont_from_vals(uint16_t const *v, uint32_t n,
+                                               roaring_buf *out) {
+  uint32_t nruns = 1;
+  for (uint32_t i = 1; i < n; i++)
+    nruns += v[i] != v[i - 1] + 1;
+  if (roaring_pick(n, nruns) != ROARING_RUN)
+    return cont_intern(ROARING_ARRAY, v, n, n);
+  uint32_t k = 0;
+  for (uint32_t i = 0; i < n; i++) {
+    if (k > 0 && v[i] == out->runs[k - 1].last + 1) {
+      out->runs[k - 1].last = v[i];
+    } else {
+      out->runs[k].start = v[i];
+      out->runs[k].last = v[i];
+      k++;
+    }
+  }
+  return cont_intern(ROARING_RUN, out->runs, k, n);
+}
+
+/* sorted, disjoint, non-adjacent runs; n is at most ROARING_RUN_MAX */
+static roaring_container const *cont_from_runs(roaring_run const *r,
+                                               uint32_t n, roaring_buf *out) {
+  uint32_t card = 0;
+  for (uint32_t i = 0; i < n; i++)
+    card += (uint32_t)r[i].last - r[i].start + 1;
+  switch (roaring_pick(card, n)) {
+  case ROARING_RUN:
+    return cont_intern(ROARING_RUN, r, n, card);
+  case ROARING_ARRAY: {
+    uint32_t k = 0;
+    for (uint32_t i = 0; i < n; i++)
+      for (uint32_t v = r[i].start; v <= r[i].last; v++)
+        out->vals[k++] = v;
+    return cont_intern(ROARING_ARRAY, out->vals, card, card);
+  }
+  default:
+    memset(out->words, 0, sizeof(out->words));
+    for (uint32_t i = 0; i < n; i++)
+      tag_bits_fill(out->words, r[i].start, (size_t)r[i].last - r[i].start + 1,
+                    true);
+    return cont_intern(ROARING_BITMAP, out->words, ROARING_WORDS, card);
+  }
+}
+
+static uint32_t vals_union(uint16_t const *a, uint32_t na, uint16_t const *b,
+                           uint32_t nb, uint16_t *out) {
+  uint32_t i = 0, j = 0, k = 0;
+  while (i < na && j < nb) {
+    uint16_t v = a[i] <= b[j] ? a[i] : b[j];
+    i += a[i] == v;
+    j += b[j] == v;
+    out[k++] = v;
+  }
+  while (i < na)
+    out[k++] = a[i++];
+  while (j < nb)
+    out[k++] = b[j++];
+  return k;
+}
+
+/* the i-th interval of an array or run container */
+static inline void cont_interval(roaring_container const *c, uint32_t i,
+                                 uint32_t &s, uint32_t &l) {
+  if (c->type == ROARING_ARRAY) {
+    s = l = c->vals()[i];
+  } else {
+    s = c->runs()[i].start;
+    l = c->runs()[i].last;
+  }
+}
+
+/*
+ * merge the intervals of two array or run containers into runs; false if
+ * the result has more than ROARING_RUN_MAX of them
+ */
+static bool runs_union(roaring_container const *a, roaring_container const *b,
+                       roaring_run *runs, uint32_t *n) {
+  uint32_t i = 0, j = 0, k = 0;
+  uint32_t as = 0, al = 0, bs = 0, bl = 0;
+  if (a->n > 0)
+    cont_interval(a, 0, as, al);
+  if (b->n > 0)
+    cont_interval(b, 0, bs, bl);
+  while (i < a->n || j < b->n) {
+    uint32_t s, l;
+    if (j == b->n || (i < a->n && as <= bs)) {
+      s = as;
+      l = al;
+      if (++i < a->n)
+        cont_interval(a, i, as, al);
+    } else {
+      s = bs;
+      l = bl;
+      if (++j < b->n)
+        cont_interval(b, j, bs, bl);
+    }
+    if (k > 0 && s <= (uint32_t)runs[k - 1].last + 1) {
+      if (l > runs[k - 1].last)
+        runs[k - 1].last = l;
+      continue;
+    }
+    if (k == ROARING_RUN_MAX)
+      return false;
+    runs[k].start = s;
+    runs[k].last = l;
+    k++;
+  }
+  *n = k;
+  return true;
+}
+
+/*
+ * the union of two interned containers. Like every other container it is
+ * interned, so a union that adds nothing to one side returns that side
+ */
+static roaring_container const *cont_union(roaring_container const *a,
+                                           roaring_container const *b) {
+  if (a == b || a->card == ROARING_WORDS * 64)
+    return a;
+  if (b->card == ROARING_WORDS * 64)
+    return b;
+  roaring_buf buf, out;
+  if (b->type == ROARING_BITMAP)
+    std::swap(a, b);
+  if (a->type == ROARING_BITMAP) {
+    memcpy(buf.words, a->words(), sizeof(buf.words));
+    words_add(buf.words, b);
+    return cont_from_words(buf.words, &out);
+  }
+  if (a->type == ROARING_ARRAY && b->type == ROARING_ARRAY &&
+      a->n + b->n <= ROARING_ARRAY_MAX)
+    return cont_from_vals(
+        buf.vals, vals_union(a->vals(), a->n, b->vals(), b->n, buf.vals),
+        &out);
+  uint32_t n;
+  if ((a->type == ROARING_RUN || b->type == ROARING_RUN) &&
+      runs_union(a, b, buf.runs, &n))
+    return cont_from_runs(buf.runs, n, &out);
+  memset(buf.words, 0, sizeof(buf.words));
+  words_add(buf.words, a);
+  words_add(buf.words, b);
+  return cont_from_words(buf.words, &out);
+}
+
+RoaringTag RoaringTag::single(uint32_t offset) {
+  uint16_t key = offset >> 16, val = offset & 0xffff;
+  roaring_container const *c = cont_intern(ROARING_ARRAY, &val, 1, 1);
+  return RoaringTag(set_intern(&key, &c, 1));
+}
+
+RoaringTag RoaringTag::range(uint32_t begin, uint32_t end) {
+  if (begin >= end)
+    return RoaringTag();
+  uint32_t first = begin >> 16, last = (end - 1) >> 16;
+  std::vector<uint16_t> keys;
+  std::vector<roaring_container const *> conts;
+  roaring_buf out;
+  for (uint32_t k = first; k <= last; k++) {
+    roaring_run r;
+    r.start = k == first ? begin & 0xffff : 0;
+    r.last = k == last ? (end - 1) & 0xffff : 0xffff;
+    keys.push_back(k);
+    conts.push_back(cont_from_runs(&r, 1, &out));
+  }
+  return RoaringTag(set_intern(keys.data(), conts.data(), keys.size()));
+}
+
+// Key-by-key merge that shares the containers of keys only one side has;
+// the pair of sets is cached, so repeated combines only cost a lookup.
+RoaringTag RoaringTag::merge(RoaringTag const &a, RoaringTag const &b) {
+  roaring_set const *x = a.set, *y = b.set;
+  if (x == y || y == NULL)
+    return a;
+  if (x == NULL)
+    return b;
+  if (x > y)
+    std::swap(x, y);
+  roaring_cache_entry *e =
+      &roaring_cache[roaring_mix(roaring_mix(0, (uintptr_t)x), (uintptr_t)y) &
+                     ((1 << ROARING_CACHE_BITS) - 1)];
+  roaring_set const *res = NULL;
+  roaring_lock_acquire();
+  if (e->a == x && e->b == y)
+    res = e->res;
+  roaring_lock_release();
+  if (res != NULL)
+    return RoaringTag(res);
+
+  std::vector<uint16_t> keys(x->n + y->n);
+  std::vector<roaring_container const *> conts(x->n + y->n);
+  uint16_t const *xk = x->keys(), *yk = y->keys();
+  uint32_t i = 0, j = 0, k = 0;
+  while (i < x->n || j < y->n) {
+    if (j == y->n || (i < x->n && xk[i] < yk[j])) {
+      keys[k] = xk[i];
+      conts[k++] = x->conts()[i++];
+    } else if (i == x->n || yk[j] < xk[i]) {
+      keys[k] = yk[j];
+      conts[k++] = y->conts()[j++];
+    } else {
+      keys[k] = xk[i];
+      conts[k++] = cont_union(x->conts()[i++], y->conts()[j++]);
+    }
+  }
+  res = set_intern(keys.data(), conts.data(), k);
+
+  roaring_lock_acquire();
+  e->a = x;
+  e->b = y;
+  e->res = res;
+  roaring_lock_release();
+  return RoaringTag(res);
+}
+
+// All containers of the inputs grouped by key; a key held by more than two
+// distinct containers is or-ed into one bitmap, so no partial unions are
+// interned.
+RoaringTag RoaringTag::merge_n(RoaringTag const *tags, size_t count) {
+  std::vector<roaring_set const *> sets;
+  for (size_t i = 0; i < count; i++)
+    if (tags[i].set != NULL)
+      sets.push_back(tags[i].set);
+  std::sort(sets.begin(), sets.end());
+  sets.erase(std::unique(sets.begin(), sets.end()), sets.end());
+  if (sets.empty())
+    return RoaringTag();
+  if (sets.size() == 1)
+    return RoaringTag(sets[0]);
+  if (sets.size() == 2)
+    return merge(RoaringTag(sets[0]), RoaringTag(sets[1]));
+
+  typedef std::pair<uint16_t, roaring_container const *> item;
+  std::vector<item> all;
+  for (size_t i = 0; i < sets.size(); i++)
+    for (uint32_t j = 0; j < sets[i]->n; j++)
+      all.push_back(item(sets[i]->keys()[j], sets[i]->conts()[j]));
+  std::sort(all.begin(), all.end());
+  all.erase(std::unique(all.begin(), all.end()), all.end());
+
+  std::vector<uint16_t> keys;
+  std::vector<roaring_container const *> conts;
+  roaring_buf buf, out;
+  for (size_t i = 0; i < all.size();) {
+    size_t j = i + 1;
+    while (j < all.size() && all[j].first == all[i].first)
+      j++;
+    roaring_container const *c = all[i].second;
+    if (j - i == 2) {
+      c = cont_union(c, all[i + 1].second);
+    } else if (j - i > 2) {
+      memset(buf.words, 0, sizeof(buf.words));
+      for (size_t m = i; m < j; m++)
+        words_add(buf.words, all[m].second);
+      c = cont_from_words(buf.words, &out);
+    }
+    keys.push_back(all[i].first);
+    conts.push_back(c);
+    i = j;
+  }
+  return RoaringTag(set_intern(keys.data(), conts.data(), keys.size()));
+}
+
+std::string RoaringTag::to_string() const {
+  std::string ss = "";
+  ss += "{";
+  char buf[100];
+  uint32_t begin = 0, end = 0; /* the pending [begin, end) */
+  auto add = [&](uint32_t s, uint32_t e) {
+    if (end > begin && s == end) {
+      end = e;
+      return;
+    }
+    if (end > begin) {
+      sprintf(buf, "(%u, %u) ", begin, end);
+      ss += buf;
+    }
+    begin = s;
+    end = e;
+  };
+  for (uint32_t i = 0; set != NULL && i < set->n; i++) {
+    roaring_container const *c = set->conts()[i];
+    uint32_t base = (uint32_t)set->keys()[i] << 16;
+    if (c->type == ROARING_BITMAP) {
+      uint32_t pos = 0, s;
+      while ((s = words_next(c->words(), pos, true)) < ROARING_WORDS * 64) {
+        pos = words_next(c->words(), s, false);
+        add(base + s, base + pos);
+      }
+    } else {
+      for (uint32_t j = 0; j < c->n; j++) {
+        uint32_t s, l;
+        cont_interval(c, j, s, l);
+        add(base + s, base + l + 1);
+      }
+    }
+  }
+  add(0, 0);
+  ss += "}";
+  return ss;
+}
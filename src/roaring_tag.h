@@ -0,0 +1,78 @@
+//! Implements a tag as an interned roaring bitmap of input offsets.
+
+#ifndef ROARING_TAG_H
+#define ROARING_TAG_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+#define ROARING_ARRAY_MAX 4096 /* values of an array container */
+#define ROARING_WORDS 1024     /* 64-bit words of a bitmap container */
+#define ROARING_RUN_MAX 2048   /* runs of a run container */
+#define ROARING_INTERN_BITS 16 /* 2^bits buckets per intern table */
+#define ROARING_CACHE_BITS 14  /* 2^bits slots of the combine cache */
+#define ROARING_ARENA_CHUNK (1 << 20)
+
+enum roaring_type { ROARING_ARRAY, ROARING_BITMAP, ROARING_RUN };
+
+struct roaring_run {
+  uint16_t start;
+  uint16_t last; /* inclusive */
+};
+
+/*
+ * the low 16 bits of the offsets sharing one high key, as a sorted array,
+ * a 2^16-bit bitmap or a list of runs, whichever is smallest. The choice
+ * only depends on the values, so equal containers have equal bytes and
+ * are interned into one immutable copy. The data follows the header
+ */
+struct roaring_container {
+  roaring_container *next; /* intern chain */
+  uint64_t hash;
+  uint32_t type;
+  uint32_t n;    /* values, words or runs */
+  uint32_t card; /* number of offsets */
+  uint32_t pad;
+
+  uint16_t const *vals() const { return (uint16_t const *)(this + 1); }
+  uint64_t const *words() const { return (uint64_t const *)(this + 1); }
+  roaring_run const *runs() const { return (roaring_run const *)(this + 1); }
+};
+
+/*
+ * an interned set: the sorted high keys and their containers. Sets and
+ * containers are never freed, so a set pointer identifies its contents
+ */
+struct roaring_set {
+  roaring_set *next; /* intern chain */
+  uint64_t hash;
+  uint32_t n;
+  uint32_t pad;
+
+  roaring_container const *const *conts() const {
+    return (roaring_container const *const *)(this + 1);
+  }
+  uint16_t const *keys() const { return (uint16_t const *)(conts() + n); }
+};
+
+class RoaringTag {
+private:
+  roaring_set const *set; /* NULL for the empty set */
+
+public:
+  RoaringTag() : set(NULL) {}
+  explicit RoaringTag(roaring_set const *s) : set(s) {}
+
+  bool empty() const { return set == NULL; }
+  bool operator==(const RoaringTag &rhs) const { return set == rhs.set; }
+  roaring_set const *get() const { return set; }
+
+  static RoaringTag single(uint32_t offset);
+  static RoaringTag range(uint32_t begin, uint32_t end); /* [begin, end) */
+  static RoaringTag merge(RoaringTag const &a, RoaringTag const &b);
+  static RoaringTag merge_n(RoaringTag const *tags, size_t count);
+  std::string to_string() const;
+};
+
+#endif // ROARING_TAG_H
@@ -6,18 +6,28 @@ typedef enum
 {
     ss_combine_wait,
     ss_alloc_wait,
+    ss_mag_refill_wait,
 
     ss_cache_access,
     ss_cache_hit,
+    ss_cache_miss,
+    ss_cache_evict,
+    ss_intern_hit,
+    ss_intern_miss,
 
     ss_combine,
     ss_alloc,
+    ss_alloc_hit,
+    ss_mag_refill,
 
     ss_cb_ll,
     ss_cb_lh,
     ss_cb_hh,
 
     bdd_cb_count,
+    bdd_bench_or,     //SSA_BENCH_OR：sylvan_or_alone的周期数
+    bdd_bench_andnot, //SSA_BENCH_OR：not/and/not的周期数
+    bdd_bench_diff,   //SSA_BENCH_OR：两种方式结果不一致的次数
 
     ss_max
 } ss_index;
@@ -34,10 +44,42 @@ __rdtsc (void) { return __builtin_ia32_rdtsc ();}
 
 #define LACE_DQ_SIZE 1000000 //
 #define SYLVAN_MEMORY_LIMIT 512 * 1024 * 1024 //512mb
-#define HELPER_THREAD_NUM 0  //no helper thread until we figure out how to identify heavy work
+#define HELPER_THREAD_NUM 0  //no helper thread by default; with PARALLEL_COMBINE_ENABLE they only join unions whose operands are large by their size estimate
 
 #define SSA_BLK 0x10000 // 0x100000
 #define SSA_GC_THRESHOLD SSA_BLK / 2 //申请新SSA块的阈值
+#define SSA_BLK_INIT 0x100 //ssa块表的初始大小，用满时加倍
+#define SSA_REGION_BLKS ((1ULL << 31) / SSA_BLK - 1) //SSA_PAGE_PACKED：ssa_region保留的块数，下标加1左移一位后仍在32位以内
+#define SSA_GC_MAX_AGE 3 //全部存活的块最多连续被跳过(2^age - 1)次gc
+#define SSA_GC_KEEP_FREE SSA_BLK * 2 //其他块中空闲ssa不少于该值时，完全空闲的块归还给系统
+#define SSA_MAG_SIZE 512 //每个线程本地缓存的空闲ssa数量，一次从free_ssa中批量取出
+#define SSA_CB_CACHE_SETS 64 //合并cache的组数，必须是2的幂
+#define SSA_CB_CACHE_WAYS 4  //合并cache每组的路数
+#if SSA_INLINE_OPS
+#define SSA_ASYNC_COMBINE 0 //在app线程上执行时没有需要隐藏的握手延迟
+#else
+/*
+置1时合并请求放入ring异步执行，立即返回future（仅gc模式），隐藏与worker握手的延迟。
+代价是未完成的结果各自占用一个ssa，无法intern，相同的集合可能得到不同的ssa，
+比较tag的工具会看到不相等。默认关闭，相同的集合总是共享同一个ssa
+*/
+#define SSA_ASYNC_COMBINE 0
+#endif
+#define SSA_ALLOC_BATCH 0x1000 //一次批量分配请求最多包含的tag数，与页大小一致
+#define SSA_INTERN_BITS 22 //intern表的桶数为2^SSA_INTERN_BITS，每个桶是一条ssa链表
+#define SSA_SINGLE_BITS 12 //单元素tag表每个叶子覆盖2^SSA_SINGLE_BITS个offset，叶子按需分配
+#define SSA_SIZE_MAX (1ULL << 40) //ssa大小估计的上限，估计值求和时不会溢出
+/*
+SSA_INLINE_SETS：不超过两个offset或一段连续区间的集合直接存放在ssa_tag中，放不下时才构造bdd（仅gc模式）。
+开启后分配总是返回内联的tag，批量分配(SSA_Batch)不再使用，单元素tag表只在内联集合升级为bdd时用到，
+因此默认关闭
+*/
+#define SSA_INLINE_SETS 0
+/*
+SSA_PAGE_PACKED：tag页中每个tag只占32位，存放内联的集合或ssa在ssa_region中的下标（仅gc模式）。
+ssa_region在启动时就要预留SSA_REGION_BLKS个块（约64GB，MAP_NORESERVE）的地址空间，因此默认关闭
+*/
+#define SSA_PAGE_PACKED 0
 
 #ifdef SSA_PROFILE
 #define SS_ADD(idx, count) tls->ss[idx] += count
@@ -69,6 +111,10 @@ void ssa_exit();
 void ssa_thread_start(uint64_t tid);
 void ssa_thread_fini(uint64_t tid);
 ssa_tag ssa_tag_alloc(unsigned int offset, uint64_t tid);
+void ssa_tag_alloc_n(ssa_tag *tags, unsigned int offset, size_t n, uint64_t tid);
+ssa_tag ssa_tag_alloc_range(unsigned int begin, unsigned int end, uint64_t tid);
 ssa_tag ssa_tag_combine(ssa_tag const &lhs, ssa_tag const &rhs, uint64_t tid);
+ssa_tag ssa_tag_combine_n(ssa_tag const *tags, size_t n, uint64_t tid);
+void ssa_tag_combine_v(ssa_tag *dst, ssa_tag const *lhs, ssa_tag const *rhs, size_t n, uint64_t tid);
 std::string ssa_tag_print(ssa_tag const &tag);
 #endif
\ No newline at end of file
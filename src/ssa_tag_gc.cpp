@@ -1,9 +1,10 @@
 #include "ssa_tag.h"
 #include "sylvan_int.h"
-#include "list"
 #include "map"
+#include "set"
 #include "algorithm"
 #include "libdft_api.h"
+#include <sys/mman.h>
 
 #ifdef TAG_SSA
 #ifdef TAINT_COUNT
@@ -18,20 +19,38 @@ extern FILE *log_fd;
         fprintf(log_fd, __VA_ARGS__); \
     } while (0)
 
+/*
+合并cache的一项，持有三个tag的引用，被淘汰时引用随之释放
+*/
+typedef struct
+{
+    ssa_tag l;
+    ssa_tag r;
+    ssa_tag v;
+} ssa_cb_entry;
+
 typedef struct
 {
-    ssa_tag cb_cache_l;
-    ssa_tag cb_cache_r;
-    ssa_tag cb_cache_v;
+    ssa_cb_entry *cb_cache; //SSA_CB_CACHE_SETS组，每组SSA_CB_CACHE_WAYS路，组内按最近使用排序
     int volatile quit;
     SSA_Task *t;
-    uint64_t pading[3];
+    void **batch; //批量分配时暂存ssa指针，首次使用时分配
+    ssa **mag;    //线程本地的空闲ssa缓存(magazine)
+    uint64_t mag_n;
+    ssa_tag *inflight; //未回收的合并请求持有的引用，每个ring槽位3个
+    uint64_t ring_done; //inflight中已经释放到的请求序号
+    uint64_t volatile inline_busy; //SSA_INLINE_OPS：正在本线程上执行BDD请求，sylvan gc需要等待它清零
+    SSA_Pairs *pairs; //ssa_tag_combine_v的请求，结果全部intern之前由ssa_gc_mark标记，不用时res全为0
+    uint64_t pading[6];
 #ifdef SSA_PROFILE
     uint64_t ss[ss_max];
-    uint64_t pading2[6];
+    uint64_t pading2[2];
 #endif
 } ssa_tls_t;
 
+#define SSA_UNUSED 0xffffffffffffffff   //从未被使用过
+#define SSA_RESERVED 0xfffffffffffffffe //已经位于free_ssa队列或某个线程的magazine中
+
 struct
 {
     volatile uint64_t __attribute__((aligned(LINE_SIZE))) _h;
@@ -39,11 +58,305 @@ struct
     ssa **__attribute__((aligned(LINE_SIZE))) _q;
     uint64_t __attribute__((aligned(LINE_SIZE))) gc_lock;
 } free_ssa;
-std::list<ssa *> ssa_blk_list;
+
+/*
+ssa块表，gc按下标循环扫描。sp为NULL表示该位置的块已经归还给系统，之后
+add_ssa_blk可以重新使用这个位置
+*/
+typedef struct
+{
+    ssa *volatile sp;
+    uint32_t live;  //上次扫描时仍被引用的ssa数量
+    uint32_t nfree; //上次扫描时可回收的ssa数量（ref_count为0或从未使用）
+    uint32_t age;   //连续全部存活的扫描次数
+    uint32_t skip;  //之后的gc中还需要跳过该块的次数
+} ssa_blk_t;
+
+ssa_blk_t *volatile ssa_blk_tab; //用满时在add_ssa_blk中加倍
+uint64_t ssa_blk_cap;         //ssa_blk_tab的大小
+uint64_t ssa_blk_cnt;         //ssa_blk_tab中用到的最大下标+1
+uint64_t ssa_blk_live;        //仍持有内存的块数
+uint64_t ssa_free_est;        //各块nfree之和，决定空闲块能否归还给系统
+uint64_t gc_cur_blk, gc_cur_i; //上次gc停止的位置，下次gc从这里继续
+#if SSA_PAGE_PACKED
+/*
+所有ssa块的地址空间在初始化时一次保留，第b块固定位于ssa_region + b * SSA_BLK，
+压缩tag页据此在ssa与下标之间换算。只保留不提交，块归还给系统时用MADV_DONTNEED
+释放其内存
+*/
+ssa *ssa_region;
+#endif
 
 ssa_tls_t *ssa_tls;
 
+#if SSA_INLINE_OPS
+/*
+SSA_INLINE_OPS：app线程直接用nogc算子执行自己的BDD请求，不再与worker握手。
+sylvan gc在pregc中置位ssa_inline_block，并等待所有线程的inline_busy清零，
+postgc中清除；inline_busy置位时先检查ssa_inline_block，二者不会同时通过。
+请求的结果在inline_busy清除前必须已经放进ssa，之后由ssa_gc_mark标记
+*/
+uint64_t volatile ssa_inline_block;
+
+VOID_TASK_0(ssa_inline_pregc)
+{
+    ssa_inline_block = 1;
+    mfence();
+    for (uint64_t i = 0; i < THREAD_CTX_BLK; i++)
+        while (ssa_tls[i].inline_busy != 0)
+            ;
+    lace_ssa_inline_reset();
+}
+
+VOID_TASK_0(ssa_inline_postgc)
+{
+    mfence();
+    ssa_inline_block = 0;
+}
+#endif
+
+/*
+执行t上类型为type的请求，返回时结果已经写好。SSA_INLINE_OPS下先在本线程上
+执行，gc进行中或唯一表已满时交给worker，由worker触发gc；返回true表示在本线程
+上执行，调用者放好结果之后调用ssa_task_done。等待worker时不能持有inline_busy，
+否则worker发起的gc会一直等待本线程
+*/
+static inline bool ssa_task_run(ssa_tls_t *tls, SSA_Task *t, uint64_t type)
+{
+#if SSA_INLINE_OPS
+    tls->inline_busy = 1;
+    mfence();
+    if (likely(ssa_inline_block == 0) && lace_ssa_inline(t, type))
+        return true;
+    tls->inline_busy = 0;
+#endif
+    mfence();
+    t->task_type = type;
+    lace_ssa_kick(t);
+    while (t->task_type != 0)
+        ;
+    return false;
+}
+
+static inline void ssa_task_done(ssa_tls_t *tls, bool inl)
+{
+#if SSA_INLINE_OPS
+    if (inl)
+    {
+        mfence();
+        tls->inline_busy = 0;
+    }
+#endif
+}
+
 BDD var_set;
+uint8_t var_order[TAG_WIDTH]; // offset的第i位对应cube中的下标
+
+/*
+intern表：bdd到ssa的映射，保证每个集合只有一个存活的ssa，ssa_tag的相等比较
+因此只需比较指针。每个桶是一条经由ssa::next串起的链表，桶头指针的最低位
+作为该桶的锁。
+查找只返回仍被引用的ssa，不会复活ref_count为0的ssa：引用计数由ssa_ref_try
+原子地检查并加一。gc先把ref_count从0原子地换成SSA_RESERVED，再在桶锁内把它
+从链表中摘下，不会与查找竞争
+*/
+ssa *volatile *ssa_intern_tab;
+
+static inline ssa *volatile *ssa_intern_bucket(uint64_t bdd)
+{
+    return &ssa_intern_tab[(bdd * 0x9e3779b97f4a7c15) >> (64 - SSA_INTERN_BITS)];
+}
+
+//锁住桶并返回链表头
+static inline ssa *ssa_intern_lock(ssa *volatile *b)
+{
+    while (true)
+    {
+        uint64_t h = (uint64_t)*b;
+        if (!(h & 1) && __sync_bool_compare_and_swap((uint64_t volatile *)b, h, h | 1))
+            return (ssa *)h;
+    }
+}
+
+//写回链表头的同时解锁
+static inline void ssa_intern_unlock(ssa *volatile *b, ssa *head)
+{
+    mfence();
+    *b = head;
+}
+
+static inline bool ssa_live(ssa const *s)
+{
+    uint64_t rc = s->ref_count;
+    return rc != 0 && rc != SSA_UNUSED && rc != SSA_RESERVED;
+}
+
+/*
+s仍被引用时增加其引用计数并返回true。检查和加一必须是一次CAS：分开做时，
+其他线程可能在两者之间把计数减到0，gc随即回收s
+*/
+static inline bool ssa_ref_try(ssa *s)
+{
+    while (true)
+    {
+        uint64_t rc = s->ref_count;
+        if (rc == 0 || rc == SSA_UNUSED || rc == SSA_RESERVED)
+            return false;
+        if (__sync_bool_compare_and_swap(&s->ref_count, rc, rc + 1))
+            return true;
+    }
+}
+
+//gc取得一个引用计数为0的ssa，失败时说明它不再是可回收的
+static inline bool ssa_claim(ssa *s)
+{
+    return __sync_bool_compare_and_swap(&s->ref_count, 0, SSA_RESERVED);
+}
+
+/*
+启用一个刚取出的空闲ssa。ssa_gc_mark把ref_count有效的ssa视为存活并标记其bdd，
+因此先写入bdd，release屏障之后再设置ref_count，期间开始的gc不会标记ssa中原来
+那个可能已经被回收的bdd
+*/
+static inline void ssa_activate(ssa *s, uint64_t bdd, uint64_t ref_count)
+{
+    s->bdd = bdd;
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    s->ref_count = ref_count;
+}
+
+/*
+查找存放bdd的ssa，找到时增加其引用计数。顺便摘下链表中已经不再被引用的同值ssa
+*/
+static ssa *ssa_intern_get(ssa_tls_t *tls, uint64_t bdd)
+{
+    ssa *volatile *b = ssa_intern_bucket(bdd);
+    ssa *head = ssa_intern_lock(b), *res = NULL;
+    for (ssa **pp = &head; *pp != NULL;)
+    {
+        ssa *p = *pp;
+        if (p->bdd != bdd)
+            pp = &p->next;
+        else if (ssa_ref_try(p))
+        {
+            res = p;
+            break;
+        }
+        else
+            *pp = p->next;
+    }
+    ssa_intern_unlock(b, head);
+    if (res != NULL)
+        SS_ADD(ss_intern_hit, 1);
+    else
+        SS_ADD(ss_intern_miss, 1);
+    return res;
+}
+
+/*
+把s加入intern表。如果其他线程已经加入了相同的集合，返回那个ssa并增加其
+引用计数，s保持原样由调用者处理；否则返回s
+*/
+static ssa *ssa_intern_put(ssa *s)
+{
+    ssa *volatile *b = ssa_intern_bucket(s->bdd);
+    ssa *head = ssa_intern_lock(b);
+    for (ssa *p = head; p != NULL; p = p->next)
+    {
+        if (p != s && p->bdd == s->bdd && ssa_ref_try(p))
+        {
+            ssa_intern_unlock(b, head);
+            return p;
+        }
+    }
+    s->next = head;
+    ssa_intern_unlock(b, s);
+    return s;
+}
+
+//gc回收s之前把它从intern表中摘下，s不在表中时什么也不做
+static void ssa_intern_del(ssa *s)
+{
+    ssa *volatile *b = ssa_intern_bucket(s->bdd);
+    ssa *head = ssa_intern_lock(b);
+    for (ssa **pp = &head; *pp != NULL; pp = &(*pp)->next)
+    {
+        if (*pp == s)
+        {
+            *pp = s->next;
+            break;
+        }
+    }
+    ssa_intern_unlock(b, head);
+}
+
+/*
+sylvan gc的标记回调，代替对每个ssa的sylvan_protect：所有块并行扫描，标记仍被
+引用的ssa中的bdd。尚未完成的合并结果为SSA_BDD_PENDING(mtbdd_false)，由
+mtbdd_gc_mark_rec直接跳过。
+ssa_marking不为0时块不会被释放，ssa_blk_count在置空sp之后等待它归零
+*/
+uint64_t volatile ssa_marking;
+
+VOID_TASK_1(ssa_gc_mark_blk, uint64_t, b)
+{
+    ssa *sp = ssa_blk_tab[b].sp;
+    if (sp == NULL)
+        return;
+    for (uint64_t i = 0; i < SSA_BLK; i++)
+        if (ssa_live(&sp[i]))
+            CALL(mtbdd_gc_mark_rec, sp[i].bdd);
+}
+
+VOID_TASK_0(ssa_gc_mark)
+{
+    __sync_fetch_and_add(&ssa_marking, 1);
+    uint64_t n = ssa_blk_cnt;
+    for (uint64_t b = 0; b < n; b++)
+        SPAWN(ssa_gc_mark_blk, b);
+    for (uint64_t b = 0; b < n; b++)
+        SYNC(ssa_gc_mark_blk);
+    //ssa_tag_combine_v中后端已经算出、还没有放进ssa的结果
+    for (uint64_t i = 0; ssa_tls != NULL && i < THREAD_CTX_BLK; i++)
+    {
+        SSA_Pairs *p = ssa_tls[i].pairs;
+        if (p == NULL)
+            continue;
+        uint64_t count = p->count < SSA_VEC_MAX ? p->count : SSA_VEC_MAX;
+        for (uint64_t j = 0; j < count; j++)
+            CALL(mtbdd_gc_mark_rec, p->res[j]);
+    }
+    __sync_fetch_and_sub(&ssa_marking, 1);
+}
+
+static inline uint64_t free_ssa_empty()
+{
+    return free_ssa._t >= free_ssa._h ? SSA_BLK - 1 - (free_ssa._t - free_ssa._h) : free_ssa._h - free_ssa._t - 1;
+}
+
+/*
+ssa_blk_tab加倍。调用者持有gc_lock，只有sylvan gc的ssa_gc_mark会并发读取旧表，
+与归还块时一样，换表之后等待ssa_marking归零再释放旧表
+*/
+static void ssa_blk_tab_grow()
+{
+    uint64_t cap = ssa_blk_cap * 2;
+    ssa_blk_t *old = ssa_blk_tab;
+    ssa_blk_t *tab = (ssa_blk_t *)calloc(cap, sizeof(ssa_blk_t));
+    if (tab == NULL)
+    {
+        fprintf(log_fd, "error: failed to grow the ssa block table\n");
+        libdft_die();
+        abort(); //libdft_die只是detach，旧表容纳不下新块
+    }
+    memcpy(tab, old, sizeof(ssa_blk_t) * ssa_blk_cap);
+    ssa_blk_tab = tab;
+    mfence();
+    ssa_blk_cap = cap;
+    while (ssa_marking != 0)
+        ;
+    free(old);
+}
 
 /*
 分配新的ssa_blk，并填充free_ssa_stack。可能在初始化时被调用，或者一次gc后
@@ -51,86 +364,205 @@ free_ssa_stack中可用元素仍少于阈值（75%）时被调用
 */
 void add_ssa_blk()
 {
-    uint64_t empty_count =
-        free_ssa._t >= free_ssa._h ? SSA_BLK - 1 - (free_ssa._t - free_ssa._h) : free_ssa._h - free_ssa._t - 1;
+    uint64_t empty_count = free_ssa_empty();
+    uint64_t b = 0;
+    while (b < ssa_blk_cnt && ssa_blk_tab[b].sp != NULL)
+        b++;
+#if SSA_PAGE_PACKED
+    if (b == SSA_REGION_BLKS)
+    {
+        fprintf(log_fd, "error: ssa region is full\n");
+        libdft_die();
+        abort(); //libdft_die只是detach，没有可用的块
+    }
+#endif
+    if (b == ssa_blk_cap)
+        ssa_blk_tab_grow();
+#if SSA_PAGE_PACKED
+    ssa *sp = ssa_region + b * SSA_BLK;
+#else
     ssa *sp = (ssa *)malloc(sizeof(ssa) * SSA_BLK);
+#endif
     memset((void *)sp, 0xff, sizeof(ssa) * SSA_BLK);
-    ssa_blk_list.push_back(sp);
     uint64_t temp_t = free_ssa._t;
     /*
     当empty_count小于SSA_BLK时，剩余的ssa在之后的gc时被使用
     */
     for (size_t i = 0; i < empty_count; i++)
     {
+        sp[i].ref_count = SSA_RESERVED;
         free_ssa._q[temp_t] = &sp[i];
         temp_t = (temp_t + 1) % SSA_BLK;
     }
     free_ssa._t = temp_t;
+
+    ssa_blk_t *blk = &ssa_blk_tab[b];
+    blk->live = 0;
+    blk->nfree = SSA_BLK - empty_count;
+    blk->age = 0;
+    blk->skip = 0;
+    ssa_free_est += blk->nfree;
+    ssa_blk_live++;
+    mfence();
+    blk->sp = sp;
+    if (b == ssa_blk_cnt)
+        ssa_blk_cnt++;
 }
+
+/*
+在gc从头开始扫描一个块之前统计其中被引用和可回收的ssa数量：
+全部存活的块年龄加一，之后的(2^age - 1)次gc都跳过它，长期存活的块不会在
+每次gc时被重复扫描；
+完全空闲的块在其他块中的空闲ssa足够时归还给系统，此时返回true
+*/
+static bool ssa_blk_count(uint64_t b)
+{
+    ssa_blk_t *blk = &ssa_blk_tab[b];
+    ssa *sp = blk->sp;
+    uint32_t live = 0, nfree = 0;
+    for (uint64_t i = 0; i < SSA_BLK; i++)
+    {
+        uint64_t rc = sp[i].ref_count;
+        if (rc == 0 || rc == SSA_UNUSED)
+            nfree++;
+        else if (rc != SSA_RESERVED)
+            live++;
+    }
+    ssa_free_est = ssa_free_est - blk->nfree + nfree;
+    blk->live = live;
+    blk->nfree = nfree;
+    if (live == SSA_BLK)
+    {
+        if (blk->age < SSA_GC_MAX_AGE)
+            blk->age++;
+        blk->skip = (1 << blk->age) - 1;
+    }
+    else
+        blk->age = 0;
+
+    if (nfree == SSA_BLK && ssa_blk_live > 1 && ssa_free_est - nfree >= SSA_GC_KEEP_FREE)
+    {
+        //统计之后ssa仍可能被引用，先取得全部空闲ssa，有一个失败就放弃归还
+        uint64_t i = 0;
+        for (; i < SSA_BLK; i++)
+            if (sp[i].ref_count != SSA_UNUSED && !ssa_claim(&sp[i]))
+                break;
+        if (i < SSA_BLK)
+        {
+            while (i-- > 0)
+                if (sp[i].ref_count == SSA_RESERVED)
+                    sp[i].ref_count = 0;
+            return false;
+        }
+        for (i = 0; i < SSA_BLK; i++)
+            if (sp[i].ref_count == SSA_RESERVED && sp[i].bdd != 0)
+                ssa_intern_del(&sp[i]);
+        blk->sp = NULL;
+        mfence();
+        //等待正在标记的sylvan gc离开这个块
+        while (ssa_marking != 0)
+            ;
+#if SSA_PAGE_PACKED
+        madvise((void *)sp, sizeof(ssa) * SSA_BLK, MADV_DONTNEED);
+#else
+        free(sp);
+#endif
+        ssa_free_est -= nfree;
+        ssa_blk_live--;
+        return true;
+    }
+    return false;
+}
+
 /*
 关于free_ssa的gc，ssa会在alloc和combine时被消耗，因此需要回收没有被引用的ssa
-gc发生时，free_ssa队列为空，我们将遍历ssa_blk中的ssa直到填满free_ssa队列，如果
-遍历完仍然不能填满，就分配新的ssa_blk，遍历过程中,ref_count代表该ssa的状态：
-0x0000000000000000->ssa曾经被使用过,可以使用，将其加入free_ssa队列需要unprotect对应bbd指针
-0xffffffffffffffff->ssa从未被使用过,可以使用，将其加入free_ssa队列不需要unprotect对应bbd指针
+gc发生时，free_ssa队列为空，我们从上次gc停止的位置(gc_cur_blk, gc_cur_i)开始
+遍历ssa_blk_tab直到填满free_ssa队列，跳过全部存活的块，最多遍历一轮；如果仍然
+不能填满，就分配新的ssa_blk。遍历过程中,ref_count代表该ssa的状态：
+0x0000000000000000->ssa曾经被使用过,可以使用，将其加入free_ssa队列需要先从intern表中摘下
+0xffffffffffffffff->ssa从未被使用过,可以使用
+0xfffffffffffffffe->ssa已在free_ssa队列或线程的magazine中，不能再次加入
 其他->正在被使用，不能加入free_ssa队列
+由于free_ssa为空时magazine中仍可能有空闲的ssa，加入队列的ssa都被标记为
+SSA_RESERVED，gc不会把它们重复加入队列
 */
 void ssa_gc()
 {
-    uint64_t empty_count =
-        free_ssa._t >= free_ssa._h ? SSA_BLK - 1 - (free_ssa._t - free_ssa._h) : free_ssa._h - free_ssa._t - 1;
+    uint64_t empty_count = free_ssa_empty();
     uint64_t temp_t = free_ssa._t;
+    uint64_t b = gc_cur_blk, i = gc_cur_i;
 #ifdef SSA_PROFILE_GC
     LOGD("empty_count %lu\n", empty_count);
     uint64_t unused_ssa = 0;
     uint64_t unalloced_ssa = 0;
+    uint64_t skipped_blk = 0;
+    uint64_t released_blk = 0;
     bool alloc_newblk = false;
 #endif
-    auto it = ssa_blk_list.begin();
-    while (it != ssa_blk_list.end())
+    for (uint64_t visited = 0; visited <= ssa_blk_cnt; visited++)
     {
-        for (uint64_t i = 0; i < SSA_BLK; i++)
+        ssa_blk_t *blk = &ssa_blk_tab[b];
+        if (blk->sp != NULL && i == 0)
+        {
+            if (blk->skip != 0)
+            {
+                blk->skip--;
+#ifdef SSA_PROFILE_GC
+                skipped_blk++;
+#endif
+                i = SSA_BLK;
+            }
+            else if (ssa_blk_count(b))
+            {
+#ifdef SSA_PROFILE_GC
+                released_blk++;
+#endif
+            }
+            else if (blk->nfree == 0)
+                i = SSA_BLK;
+        }
+        ssa *sp = blk->sp;
+        for (; sp != NULL && i < SSA_BLK && empty_count != 0; i++)
         {
-            if ((*it)[i].ref_count == 0) //
+            if (sp[i].ref_count == 0 && ssa_claim(&sp[i])) //
             {
-                free_ssa._q[temp_t] = &(*it)[i];
 #ifdef SSA_PROFILE_GC
                 unused_ssa++;
 #endif
                 /*
-                为了防止重复加入free_ssa queue，设置ref_count为0xffffffffffffffff,
-                并且unprotect对应bbd指针,sylvan gc即刻就被允许释放该bdd，而不必
-                等到新的bdd值替换掉旧的之后。
+                为了防止重复加入free_ssa queue，ssa_claim把ref_count设为SSA_RESERVED，
+                此后查找不会再增加它的引用计数，可以安全地从intern表中摘下。
+                ref_count为0时ssa_gc_mark已经不再标记该bdd，sylvan gc可以释放它
                 */
-                //(*it)[i].ref_count = 0xffffffffffffffff;
-                if ((*it)[i].bdd != 0)
-                    mtbdd_unprotect(&(*it)[i].bdd);
-                temp_t = (temp_t + 1) % SSA_BLK;
-                if (--empty_count == 0)
-                {
-                    free_ssa._t = temp_t;
-                    goto exit_gc;
-                }
-                continue;
+                if (sp[i].bdd != 0)
+                    ssa_intern_del(&sp[i]);
             }
-            if ((*it)[i].ref_count == 0xffffffffffffffff)
+            else if (sp[i].ref_count == SSA_UNUSED)
             {
 #ifdef SSA_PROFILE_GC
                 unalloced_ssa++;
 #endif
-                free_ssa._q[temp_t] = &(*it)[i];
-                temp_t = (temp_t + 1) % SSA_BLK;
-                if (--empty_count == 0)
-                {
-                    free_ssa._t = temp_t;
-                    goto exit_gc;
-                }
+                sp[i].ref_count = SSA_RESERVED;
+            }
+            else
                 continue;
+            free_ssa._q[temp_t] = &sp[i];
+            temp_t = (temp_t + 1) % SSA_BLK;
+            empty_count--;
+            if (blk->nfree != 0)
+            {
+                blk->nfree--;
+                ssa_free_est--;
             }
         }
-        it++;
+        if (empty_count == 0)
+            break;
+        b = (b + 1) % ssa_blk_cnt;
+        i = 0;
     }
     free_ssa._t = temp_t;
+    gc_cur_blk = b;
+    gc_cur_i = i;
     if (empty_count > SSA_GC_THRESHOLD)
     {
         add_ssa_blk();
@@ -139,28 +571,25 @@ void ssa_gc()
 #endif
     }
 
-exit_gc:
 #ifdef SSA_PROFILE_GC
-    if (alloc_newblk)
-        LOGD("gc: unused_ssa ssa %lu,unalloced_ssa %lu,ssa blk: %lu new blk\n", unused_ssa, unalloced_ssa, ssa_blk_list.size());
-    else
-        LOGD("gc: unused_ssa ssa %lu,unalloced_ssa %lu,ssa blk: %lu\n", unused_ssa, unalloced_ssa, ssa_blk_list.size());
+    LOGD("gc: unused_ssa ssa %lu,unalloced_ssa %lu,skipped blk %lu,released blk %lu,ssa blk: %lu%s\n",
+         unused_ssa, unalloced_ssa, skipped_blk, released_blk, ssa_blk_live, alloc_newblk ? " new blk" : "");
 #endif
     free_ssa.gc_lock = 0;
     return;
 }
 
-ssa_tag ssa_tag_alloc(unsigned int offset, uint64_t tid)
+/*
+从free_ssa队列中一次取出至多n个ssa，返回实际取得的数量。队列为空时触发gc
+*/
+static inline uint64_t ssa_claim_n(ssa_tls_t *tls, ssa **out, uint64_t n)
 {
-    ssa_tls_t *tls = &ssa_tls[tid];
-    SS_ADD(ss_alloc, 1);
-    //申请ssa存放新产生的tag
-    uint64_t idx;
+    uint64_t idx, tail, k;
     do
     {
         idx = free_ssa._h;
         SS_EVENT_PRE
-        while (unlikely(idx == free_ssa._t))
+        while (unlikely(idx == (tail = free_ssa._t)))
         {
             if (__sync_bool_compare_and_swap(&free_ssa.gc_lock, 0, 1))
             {
@@ -169,10 +598,123 @@ ssa_tag ssa_tag_alloc(unsigned int offset, uint64_t tid)
             SS_EVENT_SET_FACTOR
         }
         SS_EVENT_END(ss_alloc_wait);
-    } while (!__sync_bool_compare_and_swap(&free_ssa._h, idx, (idx + 1) % SSA_BLK));
+        k = tail > idx ? tail - idx : SSA_BLK - idx + tail;
+        if (k > n)
+            k = n;
+    } while (!__sync_bool_compare_and_swap(&free_ssa._h, idx, (idx + k) % SSA_BLK));
+
+    for (uint64_t i = 0; i < k; i++)
+        out[i] = free_ssa._q[(idx + i) % SSA_BLK];
+    return k;
+}
+
+/*
+从线程本地的magazine中取出一个空闲ssa，magazine为空时从free_ssa中一次补充
+至多SSA_MAG_SIZE个。线程只在补充时访问共享队列，gc期间magazine非空的线程
+不会被阻塞
+*/
+static inline ssa *ssa_mag_pop(ssa_tls_t *tls)
+{
+    if (unlikely(tls->mag_n == 0))
+    {
+        SS_ADD(ss_mag_refill, 1);
+        SS_EVENT_PRE
+        SS_EVENT_SET_FACTOR
+        tls->mag_n = ssa_claim_n(tls, tls->mag, SSA_MAG_SIZE);
+        SS_EVENT_END(ss_mag_refill_wait);
+    }
+    return tls->mag[--tls->mag_n];
+}
+
+/*
+ssa的大小估计：单元素集合是一条TAG_WIDTH个节点的路径，区间不超过两条路径。
+合并结果不超过两个操作数之和；后端给出顺序合并的递归次数时，取它与较大
+操作数中的较大者（原样沿用的操作数子图不计入递归次数）
+*/
+#define SSA_SIZE_SINGLE TAG_WIDTH
+#define SSA_SIZE_RANGE (2 * TAG_WIDTH)
+
+static inline uint64_t ssa_size_sum(uint64_t a, uint64_t b)
+{
+    a += b;
+    return a < SSA_SIZE_MAX ? a : SSA_SIZE_MAX;
+}
+
+static inline uint64_t ssa_size_est(uint64_t a, uint64_t b, uint64_t steps)
+{
+    uint64_t sum = ssa_size_sum(a, b);
+    if (steps < a)
+        steps = a;
+    if (steps < b)
+        steps = b;
+    return steps < sum ? steps : sum;
+}
 
-    ssa *victim = free_ssa._q[idx];
-    victim->ref_count = 1;
+/*
+返回存放bdd的tag：集合已经存在时共享原有的ssa，否则取一个空闲ssa加入intern表，
+size为其大小估计。两个线程同时加入相同集合时后加入的ssa被放弃，留给之后的gc回收
+*/
+static ssa_tag ssa_tag_intern(ssa_tls_t *tls, uint64_t bdd, uint64_t size)
+{
+    ssa *s = ssa_intern_get(tls, bdd);
+    if (s != NULL)
+        return ssa_tag(s);
+    ssa *victim = ssa_mag_pop(tls);
+    victim->size = size;
+    ssa_activate(victim, bdd, 1);
+    s = ssa_intern_put(victim);
+    if (s != victim)
+        victim->ref_count = 0;
+    return ssa_tag(s);
+}
+
+/*
+单元素tag表：以offset为下标保存已经分配过的单元素集合的ssa，表本身持有一个
+引用，这些ssa在gc之后依然存活。重复分配同一个offset只需一次读取和一次引用
+计数加一，不需要访问BDD后端
+*/
+#define SSA_SINGLE_LEAF (1UL << SSA_SINGLE_BITS)
+#define SSA_SINGLE_TOP ((1UL << TAG_WIDTH) >> SSA_SINGLE_BITS)
+ssa *volatile *volatile ssa_single_tab[SSA_SINGLE_TOP];
+
+static inline ssa *ssa_single_get(unsigned int offset)
+{
+    ssa *volatile *leaf = ssa_single_tab[offset >> SSA_SINGLE_BITS];
+    if (unlikely(leaf == NULL))
+        return NULL;
+    ssa *s = leaf[offset & (SSA_SINGLE_LEAF - 1)];
+    if (s != NULL)
+        ssa_ref_inc(s);
+    return s;
+}
+
+//把offset对应的ssa放入表中，其他线程已经放入时什么也不做
+static inline void ssa_single_put(unsigned int offset, ssa *s)
+{
+    ssa *volatile *volatile *top = &ssa_single_tab[offset >> SSA_SINGLE_BITS];
+    if (unlikely(*top == NULL))
+    {
+        ssa *volatile *leaf = (ssa *volatile *)calloc(SSA_SINGLE_LEAF, sizeof(ssa *));
+        //表只是缓存，分配失败时不记录这个offset
+        if (leaf == NULL)
+            return;
+        if (!__sync_bool_compare_and_swap(top, NULL, leaf))
+            free((void *)leaf);
+    }
+    ssa_ref_inc(s);
+    if (!__sync_bool_compare_and_swap(&(*top)[offset & (SSA_SINGLE_LEAF - 1)], NULL, s))
+        ssa_ref_dec(s);
+}
+
+static ssa_tag ssa_tag_alloc_bdd(ssa_tls_t *tls, unsigned int offset)
+{
+    SS_ADD(ss_alloc, 1);
+    ssa *s = ssa_single_get(offset);
+    if (likely(s != NULL))
+    {
+        SS_ADD(ss_alloc_hit, 1);
+        return ssa_tag(s);
+    }
 
     //设置参数，发送分配tag指令给BDD后端
     SSA_Task *t = tls->t;
@@ -186,16 +728,240 @@ ssa_tag ssa_tag_alloc(unsigned int offset, uint64_t tid)
     }
     t->arg1 = var_set;
     t->arg2 = (uint64_t)array;
+    bool inl = ssa_task_run(tls, t, 1);
+    //相同offset的tag共享同一个ssa
+    ssa_tag res = ssa_tag_intern(tls, t->res, SSA_SIZE_SINGLE);
+    t->res = 0;
+    ssa_task_done(tls, inl);
+    ssa_single_put(offset, res.ssa_ref);
+    return res;
+}
+
+ssa_tag ssa_tag_alloc(unsigned int offset, uint64_t tid)
+{
+#if SSA_INLINE_SETS
+    ssa_tls_t *tls = &ssa_tls[tid];
+    SS_ADD(ss_alloc, 1);
+    return ssa_tag(SSA_INLINE_MAKE(offset, offset, false));
+#else
+    return ssa_tag_alloc_bdd(&ssa_tls[tid], offset);
+#endif
+}
+
+/*
+返回(l, r)所在的组。相同的集合共享同一个ssa，key直接使用ssa地址，不需要
+访问ssa本身。合并满足交换律，l与r按地址排序后再查找和插入
+*/
+static inline ssa_cb_entry *ssa_cb_set(ssa_tls_t *tls, ssa_tag const *&l, ssa_tag const *&r)
+{
+    uint64_t kl = (uint64_t)l->ssa_ref, kr = (uint64_t)r->ssa_ref;
+    if (kl > kr)
+    {
+        std::swap(l, r);
+        std::swap(kl, kr);
+    }
+    uint64_t h = kl * 0x9e3779b97f4a7c15 ^ kr * 0xc2b2ae3d27d4eb4f;
+    return &tls->cb_cache[((h >> 32) & (SSA_CB_CACHE_SETS - 1)) * SSA_CB_CACHE_WAYS];
+}
+
+//在组中查找，命中的项移到第0路
+static inline ssa_tag *ssa_cb_lookup(ssa_tls_t *tls, ssa_cb_entry *set, ssa_tag const &l, ssa_tag const &r)
+{
+    SS_ADD(ss_cache_access, 1);
+    for (int w = 0; w < SSA_CB_CACHE_WAYS; w++)
+    {
+        if (set[w].l == l && set[w].r == r)
+        {
+            SS_ADD(ss_cache_hit, 1);
+            for (; w > 0; w--)
+                std::swap(set[w], set[w - 1]);
+            return &set[0].v;
+        }
+    }
+    SS_ADD(ss_cache_miss, 1);
+    return NULL;
+}
+
+//插入到第0路，最后一路被淘汰
+static inline void ssa_cb_insert(ssa_tls_t *tls, ssa_cb_entry *set, ssa_tag const &l, ssa_tag const &r, ssa_tag const &v)
+{
+    if (set[SSA_CB_CACHE_WAYS - 1].v.ssa_ref != NULL)
+        SS_ADD(ss_cache_evict, 1);
+    for (int w = SSA_CB_CACHE_WAYS - 1; w > 0; w--)
+        set[w] = std::move(set[w - 1]);
+    set[0].l = l;
+    set[0].r = r;
+    set[0].v = v;
+}
+
+#if SSA_ASYNC_COMBINE
+/*
+把已经完成的合并结果加入intern表。结果的引用已经交给调用者，无法再替换成
+已有的ssa，只能让cache中对应的项改为指向已有的ssa，之后相同的合并直接得到它
+*/
+static inline void ssa_ring_intern(ssa_tls_t *tls, ssa_tag *held)
+{
+    ssa *victim = held[2].ssa_ref;
+    ssa *s = ssa_intern_put(victim);
+    if (s == victim)
+        return;
+    ssa_tag canon(s);
+    ssa_tag const *l = &held[0], *r = &held[1];
+    ssa_cb_entry *set = ssa_cb_set(tls, l, r);
+    for (int w = 0; w < SSA_CB_CACHE_WAYS; w++)
+    {
+        if (set[w].v.ssa_ref == victim && set[w].l == *l && set[w].r == *r)
+        {
+            set[w].v = std::move(canon);
+            break;
+        }
+    }
+}
+
+/*
+释放已经完成的合并请求持有的引用。请求完成之前持有两个操作数以及结果的引用，
+保证worker读写时这些ssa不会被gc回收
+*/
+static inline void ssa_ring_reclaim(ssa_tls_t *tls)
+{
+    uint64_t h = tls->t->ring->_h;
+    while (tls->ring_done != h)
+    {
+        ssa_tag *held = &tls->inflight[(tls->ring_done % SSA_RING_SIZE) * 3];
+        ssa_ring_intern(tls, held);
+        held[0] = ssa_tag();
+        held[1] = ssa_tag();
+        held[2] = ssa_tag();
+        tls->ring_done++;
+    }
+}
+
+/*
+把lhs与rhs的合并请求放入ring并立即返回存放结果的ssa，后端完成之前其bdd为
+SSA_BDD_PENDING。ring满时等待后端
+*/
+static inline ssa *ssa_ring_push(ssa_tls_t *tls, ssa_tag const &lhs, ssa_tag const &rhs)
+{
+    SSA_Ring *r = tls->t->ring;
+    uint64_t tail = r->_t;
+    SS_EVENT_PRE
+    while (unlikely(tail - r->_h == SSA_RING_SIZE))
+    {
+        SS_EVENT_SET_FACTOR
+    }
+    SS_EVENT_END(ss_combine_wait);
+    ssa_ring_reclaim(tls);
+
+    ssa *victim = ssa_mag_pop(tls);
+    uint64_t ls = lhs.ssa_ref->size, rs = rhs.ssa_ref->size;
+    victim->size = ssa_size_sum(ls, rs);
+    ssa_activate(victim, SSA_BDD_PENDING, 2); //返回的tag与inflight各一个
+
+    uint64_t slot = tail % SSA_RING_SIZE;
+    ssa_tag *held = &tls->inflight[slot * 3];
+    held[0] = lhs;
+    held[1] = rhs;
+    held[2] = ssa_tag(victim);
+
+    SSA_Req *q = &r->q[slot];
+    q->l = &lhs.ssa_ref->bdd;
+    q->r = &rhs.ssa_ref->bdd;
+    q->dst = &victim->bdd;
+    q->hint = ls < rs ? ls : rs;
+    q->floor = ls < rs ? rs : ls;
+    q->size = &victim->size;
     mfence();
-    t->task_type = 1;
-    while (t->task_type != 0)
+    r->_t = tail + 1;
+    lace_ssa_kick(tls->t);
+    return victim;
+}
+
+//等待所有已经提交的合并请求完成
+static void ssa_ring_drain(ssa_tls_t *tls)
+{
+    SSA_Ring *r = tls->t->ring;
+    while (r->_h != r->_t)
         ;
-    victim->bdd = t->res;
-    sylvan_protect(&victim->bdd);
-    t->res = 0;
-    return ssa_tag(victim);
+    ssa_ring_reclaim(tls);
+}
+#endif
+
+/*
+读取tag内容之前等待对应的合并完成。tag_is_empty只比较ssa_ref，不需要等待；
+内联的集合没有对应的合并
+*/
+static inline void ssa_tag_wait(ssa_tag const &tag)
+{
+    if (tag.holds_ssa())
+        while (*(uint64_t volatile *)&tag.ssa_ref->bdd == SSA_BDD_PENDING)
+            ;
 }
 
+#if SSA_INLINE_SETS
+//把内联集合拆成区间追加到lo/hi中，返回区间数
+static inline int ssa_inline_spans(uint64_t w, uint32_t *lo, uint32_t *hi, int n)
+{
+    uint32_t a = SSA_INLINE_A(w), b = SSA_INLINE_B(w);
+    if ((w & SSA_INLINE_RANGE) || a == b)
+    {
+        lo[n] = a;
+        hi[n] = b;
+        return n + 1;
+    }
+    lo[n] = hi[n] = a;
+    lo[n + 1] = hi[n + 1] = b;
+    return n + 2;
+}
+
+/*
+在app线程上计算两个内联集合的并集。结果仍能内联（跨度小于SSA_INLINE_SPAN）时
+写入out并返回true，编码是唯一的，相同的集合得到相同的ssa_ref
+*/
+static inline bool ssa_inline_union(ssa *x, ssa *y, ssa *&out)
+{
+    uint32_t lo[4], hi[4];
+    int n = ssa_inline_spans((uint64_t)x, lo, hi, 0);
+    n = ssa_inline_spans((uint64_t)y, lo, hi, n);
+    //按起点插入排序，再合并相交或相邻的区间
+    for (int i = 1; i < n; i++)
+        for (int j = i; j > 0 && lo[j] < lo[j - 1]; j--)
+        {
+            std::swap(lo[j], lo[j - 1]);
+            std::swap(hi[j], hi[j - 1]);
+        }
+    int m = 0;
+    for (int i = 1; i < n; i++)
+    {
+        if (lo[i] <= hi[m] + 1)
+        {
+            if (hi[i] > hi[m])
+                hi[m] = hi[i];
+        }
+        else
+        {
+            m++;
+            lo[m] = lo[i];
+            hi[m] = hi[i];
+        }
+    }
+    if (hi[m] - lo[0] >= SSA_INLINE_SPAN)
+        return false;
+    if (m == 0)
+    {
+        out = SSA_INLINE_MAKE(lo[0], hi[0], hi[0] - lo[0] >= 2);
+        return true;
+    }
+    if (m == 1 && lo[0] == hi[0] && lo[1] == hi[1])
+    {
+        out = SSA_INLINE_MAKE(lo[0], lo[1], false);
+        return true;
+    }
+    return false;
+}
+
+static ssa_tag ssa_inline_promote(ssa_tls_t *tls, ssa_tag const &tag, uint64_t tid);
+#endif
+
 ssa_tag ssa_tag_combine(ssa_tag const &lhs, ssa_tag const &rhs, uint64_t tid)
 {
     //边界条件
@@ -203,28 +969,60 @@ ssa_tag ssa_tag_combine(ssa_tag const &lhs, ssa_tag const &rhs, uint64_t tid)
         return rhs;
     if (rhs.ssa_ref == NULL || lhs == rhs)
         return lhs;
+#if SSA_INLINE_SETS
+    //两个内联集合的并集仍能内联时不需要后端
+    ssa *w;
+    if (lhs.is_inline() && rhs.is_inline() && ssa_inline_union(lhs.ssa_ref, rhs.ssa_ref, w))
+        return ssa_tag(w);
+#endif
 
 #ifdef TAINT_COUNT
     combine_count++;
 #endif
     //检查cache是否命中
     ssa_tls_t *tls = &ssa_tls[tid];
-    SS_ADD(ss_cache_access, 1);
-    if (tls->cb_cache_l == lhs && tls->cb_cache_r == rhs)
+    ssa_tag const *l = &lhs, *r = &rhs;
+    ssa_cb_entry *set = ssa_cb_set(tls, l, r);
+    ssa_tag *hit = ssa_cb_lookup(tls, set, *l, *r);
+    if (hit != NULL)
+        return *hit;
+
+    //参与bdd合并的操作数：内联的集合放不下结果，先升级为bdd，cache仍以原来的tag为key
+    ssa_tag pl, pr;
+    ssa_tag const *bl = &lhs, *br = &rhs;
+#if SSA_INLINE_SETS
+    if (lhs.is_inline())
+    {
+        pl = ssa_inline_promote(tls, lhs, tid);
+        bl = &pl;
+    }
+    if (rhs.is_inline())
+    {
+        pr = ssa_inline_promote(tls, rhs, tid);
+        br = &pr;
+    }
+    if (*bl == *br)
     {
-        SS_ADD(ss_cache_hit, 1);
-        return tls->cb_cache_v;
+        ssa_cb_insert(tls, set, *l, *r, *bl);
+        return *bl;
     }
+#endif
 
+#if SSA_ASYNC_COMBINE
+    //发送合并请求后不等待结果，无法再检查结果是否为lhs或rhs之一
+    SS_ADD(ss_combine, 1);
+    ssa_tag res(ssa_ring_push(tls, *bl, *br));
+    ssa_cb_insert(tls, set, *l, *r, res);
+    return res;
+#else
     //设置参数，发送合并tag指令给BDD后端
     SS_ADD(ss_combine, 1);
     SSA_Task *t = tls->t;
-    t->arg1 = lhs.ssa_ref->bdd;
-    t->arg2 = rhs.ssa_ref->bdd;
-    mfence();
-    t->task_type = 2;
-    while (t->task_type != 0)
-        ;
+    t->arg1 = bl->ssa_ref->bdd;
+    t->arg2 = br->ssa_ref->bdd;
+    uint64_t ls = bl->ssa_ref->size, rs = br->ssa_ref->size;
+    t->size = ls < rs ? ls : rs;
+    bool inl = ssa_task_run(tls, t, 2);
 
 #ifdef SSA_PROFILE_COMBINE
     /*     if (t->l_count2 < PARALLEL_COMBINE_THRESHOLD && t->r_count2 < PARALLEL_COMBINE_THRESHOLD)
@@ -246,60 +1044,419 @@ ssa_tag ssa_tag_combine(ssa_tag const &lhs, ssa_tag const &rhs, uint64_t tid)
     LOGD("\tcombine_count:%lu\n",t->cb_count); */
 #endif
 
-    //检查返回结果是否为参与合并的两个tag之一（一个tag为另一个tag的子集）
-    if (t->res == lhs.ssa_ref->bdd)
+    //检查返回结果是否为参与合并的两个tag之一（一个tag为另一个tag的子集），内联的操作数直接共享原来的tag
+    if (t->res == bl->ssa_ref->bdd)
     {
-        tls->cb_cache_l = lhs;
-        tls->cb_cache_r = rhs;
-        tls->cb_cache_v = lhs;
+        ssa_task_done(tls, inl);
+        ssa_cb_insert(tls, set, *l, *r, lhs);
         return lhs;
     }
-    if (t->res == rhs.ssa_ref->bdd)
+    if (t->res == br->ssa_ref->bdd)
     {
-        tls->cb_cache_l = lhs;
-        tls->cb_cache_r = rhs;
-        tls->cb_cache_v = rhs;
+        ssa_task_done(tls, inl);
+        ssa_cb_insert(tls, set, *l, *r, rhs);
         return rhs;
     }
 
-    //申请ssa存放新产生的tag
-    uint64_t ssa_idx;
-    do
+    //结果已经存在于其他ssa中时直接共享
+    ssa_tag res = ssa_tag_intern(tls, t->res, ssa_size_est(ls, rs, t->size));
+    t->res = 0;
+    ssa_task_done(tls, inl);
+    ssa_cb_insert(tls, set, *l, *r, res);
+    return res;
+#endif
+}
+
+/*
+合并tags[0..n)：跳过空tag和重复的tag（intern之后相同集合的tag指针相同），
+剩下两个以内时直接走ssa_tag_combine，更多时每SSA_UNION_MAX个操作数向后端
+发送一次n元合并请求，后端做平衡的两两合并，只产生一个结果ssa。
+内联的操作数先在app线程上合并，最后再与后端的结果合并
+*/
+ssa_tag ssa_tag_combine_n(ssa_tag const *tags, size_t n, uint64_t tid)
+{
+    ssa_tls_t *tls = &ssa_tls[tid];
+    ssa_tag acc;
+    ssa_tag small; //SSA_INLINE_SETS：能放进同一个内联集合的操作数先在app线程上合并
+    ssa_tag const *ops[SSA_UNION_MAX];
+    ssa_tag prom[SSA_UNION_MAX];
+    SSA_Union u;
+    size_t i = 0;
+    while (i < n)
     {
-        ssa_idx = free_ssa._h;
-        SS_EVENT_PRE
-        while (unlikely(ssa_idx == free_ssa._t))
+        uint64_t k = 0;
+        if (acc.ssa_ref != NULL)
+            ops[k++] = &acc;
+        for (; i < n && k < SSA_UNION_MAX; i++)
         {
-            if (__sync_bool_compare_and_swap(&free_ssa.gc_lock, 0, 1))
+            if (tags[i].ssa_ref == NULL)
+                continue;
+#if SSA_INLINE_SETS
+            ssa *w = tags[i].ssa_ref;
+            if (tags[i].is_inline() && (small.ssa_ref == NULL || ssa_inline_union(small.ssa_ref, w, w)))
             {
-                ssa_gc();
+                small = ssa_tag(w);
+                continue;
             }
-            SS_EVENT_SET_FACTOR
+#endif
+            uint64_t j = 0;
+            while (j < k && !(*ops[j] == tags[i]))
+                j++;
+            if (j == k)
+                ops[k++] = &tags[i];
+        }
+        if (k < 2)
+        {
+            if (k == 1 && ops[0] != &acc)
+                acc = *ops[0];
+            continue;
+        }
+        if (k == 2)
+        {
+            acc = ssa_tag_combine(*ops[0], *ops[1], tid);
+            continue;
         }
-        SS_EVENT_END(ss_alloc_wait);
-    } while (!__sync_bool_compare_and_swap(&free_ssa._h, ssa_idx, (ssa_idx + 1) % SSA_BLK));
 
-    ssa *victim = free_ssa._q[ssa_idx];
-    victim->ref_count = 1;
-    victim->bdd = t->res;
-    sylvan_protect(&victim->bdd);
-    t->res = 0;
+#ifdef TAINT_COUNT
+        combine_count++;
+#endif
+        //异步合并的操作数需要先等待结果，放不下的内联集合先升级为bdd
+        SS_ADD(ss_combine, 1);
+        uint64_t size = 0;
+        for (uint64_t j = 0; j < k; j++)
+        {
+#if SSA_INLINE_SETS
+            if (ops[j]->is_inline())
+            {
+                prom[j] = ssa_inline_promote(tls, *ops[j], tid);
+                ops[j] = &prom[j];
+            }
+#endif
+            ssa_tag_wait(*ops[j]);
+            u.ops[j] = ops[j]->ssa_ref->bdd;
+            size = ssa_size_sum(size, ops[j]->ssa_ref->size);
+        }
+        u.count = k;
+        SSA_Task *t = tls->t;
+        t->arg2 = (uint64_t)&u;
+        bool inl = ssa_task_run(tls, t, 5);
+
+        //结果为某个操作数时直接共享它的ssa
+        ssa_tag res;
+        for (uint64_t j = 0; j < k && res.ssa_ref == NULL; j++)
+            if (t->res == u.ops[j])
+                res = *ops[j];
+        if (res.ssa_ref == NULL)
+            res = ssa_tag_intern(tls, t->res, size);
+        t->res = 0;
+        ssa_task_done(tls, inl);
+        acc = std::move(res);
+    }
+#if SSA_INLINE_SETS
+    return ssa_tag_combine(acc, small, tid);
+#else
+    return acc;
+#endif
+}
+
+/*
+按通道合并，dst[i] = lhs[i] ∪ rhs[i]，dst可以就是lhs或rhs。寄存器各字节的tag
+通常相同，相同的(lhs, rhs)通道对只计算一次。同步模式下cache未命中的通道对放入
+同一个请求，整条指令只需与后端握手一次；异步模式下合并本来就不等待，逐个放入ring
+*/
+void ssa_tag_combine_v(ssa_tag *dst, ssa_tag const *lhs, ssa_tag const *rhs, size_t n, uint64_t tid)
+{
+    ssa_tls_t *tls = &ssa_tls[tid];
+    while (n > 0)
+    {
+        size_t k = n < SSA_VEC_MAX ? n : SSA_VEC_MAX;
+        ssa_tag res[SSA_VEC_MAX];
+        int same[SSA_VEC_MAX]; //与之前的通道对相同时为该通道的下标，否则为-1
+#if !SSA_ASYNC_COMBINE
+        SSA_Pairs &p = *tls->pairs;
+        ssa_tag const *ml[SSA_VEC_MAX], *mr[SSA_VEC_MAX];
+        ssa_cb_entry *mset[SSA_VEC_MAX];
+        size_t mlane[SSA_VEC_MAX];
+        p.count = 0;
+#endif
+        for (size_t i = 0; i < k; i++)
+        {
+            same[i] = -1;
+            ssa_tag const *l = &lhs[i], *r = &rhs[i];
+            if (l->ssa_ref == NULL)
+            {
+                res[i] = *r;
+                continue;
+            }
+            if (r->ssa_ref == NULL || *l == *r)
+            {
+                res[i] = *l;
+                continue;
+            }
+            size_t j = 0;
+            while (j < i && !((lhs[j] == *l && rhs[j] == *r) || (lhs[j] == *r && rhs[j] == *l)))
+                j++;
+            if (j < i)
+            {
+                same[i] = j;
+                continue;
+            }
+#if SSA_ASYNC_COMBINE
+            res[i] = ssa_tag_combine(*l, *r, tid);
+#else
+#if SSA_INLINE_SETS
+            //内联的通道可能不需要后端，放不下时由ssa_tag_combine升级
+            if (l->is_inline() || r->is_inline())
+            {
+                res[i] = ssa_tag_combine(*l, *r, tid);
+                continue;
+            }
+#endif
+            ssa_cb_entry *set = ssa_cb_set(tls, l, r);
+            ssa_tag *hit = ssa_cb_lookup(tls, set, *l, *r);
+            if (hit != NULL)
+            {
+                res[i] = *hit;
+                continue;
+            }
+            mset[p.count] = set;
+            ml[p.count] = l;
+            mr[p.count] = r;
+            mlane[p.count] = i;
+            p.l[p.count] = l->ssa_ref->bdd;
+            p.r[p.count] = r->ssa_ref->bdd;
+            p.count++;
+#endif
+        }
+
+#if !SSA_ASYNC_COMBINE
+        if (p.count > 0)
+        {
+#ifdef TAINT_COUNT
+            combine_count += p.count;
+#endif
+            SS_ADD(ss_combine, p.count);
+            SSA_Task *t = tls->t;
+            t->arg2 = (uint64_t)&p;
+            bool inl = ssa_task_run(tls, t, 6);
+            //与ssa_tag_combine相同：结果为操作数之一时共享操作数，否则加入intern表
+            for (uint64_t m = 0; m < p.count; m++)
+            {
+                ssa_tag &v = res[mlane[m]];
+                if (p.res[m] == p.l[m])
+                    v = *ml[m];
+                else if (p.res[m] == p.r[m])
+                    v = *mr[m];
+                else
+                    v = ssa_tag_intern(tls, p.res[m], ssa_size_sum(ml[m]->ssa_ref->size, mr[m]->ssa_ref->size));
+                ssa_cb_insert(tls, mset[m], *ml[m], *mr[m], v);
+            }
+            ssa_task_done(tls, inl);
+            //所有结果都已经在ssa中，不再需要ssa_gc_mark经由p.res标记
+            for (uint64_t m = 0; m < p.count; m++)
+                p.res[m] = 0;
+            mfence();
+            p.count = 0;
+        }
+#endif
+
+        //操作数全部用完之后才写dst
+        for (size_t i = 0; i < k; i++)
+            if (same[i] >= 0)
+                res[i] = res[same[i]];
+        for (size_t i = 0; i < k; i++)
+            dst[i] = std::move(res[i]);
+        dst += k;
+        lhs += k;
+        rhs += k;
+        n -= k;
+    }
+}
+
+#if !SSA_INLINE_SETS
+/*
+为连续的n个输入偏移[offset, offset + n)新建tag，结果写入tags[0..n)并放入单元素
+tag表。所有ssa一次取出，并且每SSA_ALLOC_BATCH个tag只向BDD后端发送一次请求
+*/
+static void ssa_tag_alloc_run(ssa_tls_t *tls, ssa_tag *tags, unsigned int offset, size_t n)
+{
+    if (unlikely(tls->batch == NULL))
+    {
+        tls->batch = (void **)malloc(sizeof(void *) * SSA_ALLOC_BATCH);
+        if (tls->batch == NULL)
+        {
+            fprintf(log_fd, "error: failed to allocate the tag batch\n");
+            libdft_die();
+            abort(); //libdft_die只是detach，下面会写入batch
+        }
+    }
+    ssa **victims = (ssa **)tls->batch;
+    SSA_Task *t = tls->t;
+
+    while (n > 0)
+    {
+        uint64_t count = n < SSA_ALLOC_BATCH ? n : SSA_ALLOC_BATCH;
+        for (uint64_t got = 0; got < count;)
+            got += ssa_claim_n(tls, victims + got, count - got);
 
-    ssa_tag res(victim);
-    tls->cb_cache_l = lhs;
-    tls->cb_cache_r = rhs;
-    tls->cb_cache_v = res;
+        /*
+        先设置ref_count再交给后端，后端逐个写入结果时，已经写入的bdd会被
+        ssa_gc_mark标记，不会被期间发生的sylvan gc回收
+        */
+        for (uint64_t i = 0; i < count; i++)
+        {
+            victims[i]->size = SSA_SIZE_SINGLE;
+            ssa_activate(victims[i], 0, 1);
+        }
+
+        SSA_Batch b;
+        b.offset = offset;
+        b.count = count;
+        b.order = var_order;
+        b.width = TAG_WIDTH;
+        b.dst = tls->batch;
+        b.dst_off = offsetof(ssa, bdd);
+        t->arg1 = var_set;
+        t->arg2 = (uint64_t)&b;
+        bool inl = ssa_task_run(tls, t, 3);
+
+        //已经分配过的offset共享原有的ssa，多余的ssa留给gc回收
+        for (uint64_t i = 0; i < count; i++)
+        {
+            ssa *s = ssa_intern_put(victims[i]);
+            if (s != victims[i])
+                victims[i]->ref_count = 0;
+            ssa_single_put(offset + i, s);
+            tags[i] = ssa_tag(s);
+        }
+        ssa_task_done(tls, inl);
+
+        tags += count;
+        offset += count;
+        n -= count;
+    }
+}
+#endif
+
+/*
+为连续的n个输入偏移[offset, offset + n)分配tag，结果写入tags[0..n)。
+单元素tag表中已有的offset直接共享，其余每一段连续的offset批量新建。
+SSA_INLINE_SETS时全部内联
+*/
+
+void ssa_tag_alloc_n(ssa_tag *tags, unsigned int offset, size_t n, uint64_t tid)
+{
+    ssa_tls_t *tls = &ssa_tls[tid];
+    SS_ADD(ss_alloc, n);
+#if SSA_INLINE_SETS
+    //单元素集合总是内联，不需要后端
+    for (size_t i = 0; i < n; i++)
+        tags[i] = ssa_tag(SSA_INLINE_MAKE(offset + i, offset + i, false));
+#else
+    size_t i = 0;
+    while (i < n)
+    {
+        ssa *s = ssa_single_get(offset + i);
+        if (s != NULL)
+        {
+            SS_ADD(ss_alloc_hit, 1);
+            tags[i++] = ssa_tag(s);
+            continue;
+        }
+        size_t j = i + 1;
+        while (j < n && (s = ssa_single_get(offset + j)) == NULL)
+            j++;
+        ssa_tag_alloc_run(tls, tags + i, offset + i, j - i);
+        if (j < n)
+        {
+            SS_ADD(ss_alloc_hit, 1);
+            tags[j++] = ssa_tag(s);
+        }
+        i = j;
+    }
+#endif
+}
+
+/*
+为输入偏移区间[begin, end)分配一个tag：后端按区间直接构造bdd，节点数只与
+TAG_WIDTH有关，不必先为每个offset分配tag再逐个合并
+*/
+static ssa_tag ssa_tag_alloc_range_bdd(ssa_tls_t *tls, unsigned int begin, unsigned int end)
+{
+    if (end - begin == 1)
+        return ssa_tag_alloc_bdd(tls, begin);
+    SS_ADD(ss_alloc, 1);
+    SSA_Task *t = tls->t;
+    SSA_Range r;
+    r.lo = begin;
+    r.hi = end - 1;
+    r.order = var_order;
+    t->arg1 = var_set;
+    t->arg2 = (uint64_t)&r;
+    bool inl = ssa_task_run(tls, t, 4);
+    ssa_tag res = ssa_tag_intern(tls, t->res, SSA_SIZE_RANGE);
+    t->res = 0;
+    ssa_task_done(tls, inl);
     return res;
 }
 
+ssa_tag ssa_tag_alloc_range(unsigned int begin, unsigned int end, uint64_t tid)
+{
+    if (end <= begin)
+        return ssa_tag();
+    ssa_tls_t *tls = &ssa_tls[tid];
+#if SSA_INLINE_SETS
+    //不超过SSA_INLINE_SPAN的区间内联，两个以内的offset按{a, b}编码
+    if (end - begin <= SSA_INLINE_SPAN)
+    {
+        SS_ADD(ss_alloc, 1);
+        return ssa_tag(SSA_INLINE_MAKE(begin, end - 1, end - begin > 2));
+    }
+#endif
+    return ssa_tag_alloc_range_bdd(tls, begin, end);
+}
+
+#if SSA_INLINE_SETS
+/*
+为内联的集合构造bdd，返回持有它的tag：单元素和区间直接分配，{a, b}由两个
+单元素tag合并得到
+*/
+static ssa_tag ssa_inline_promote(ssa_tls_t *tls, ssa_tag const &tag, uint64_t tid)
+{
+    uint64_t w = (uint64_t)tag.ssa_ref;
+    unsigned int a = SSA_INLINE_A(w), b = SSA_INLINE_B(w);
+    if (w & SSA_INLINE_RANGE)
+        return ssa_tag_alloc_range_bdd(tls, a, b + 1);
+    ssa_tag s = ssa_tag_alloc_bdd(tls, a);
+    if (a == b)
+        return s;
+    return ssa_tag_combine(s, ssa_tag_alloc_bdd(tls, b), tid);
+}
+#endif
+
 std::string ssa_tag_print(ssa_tag const &tag)
 {
     std::string ss = "";
     ss += "{";
     std::vector<uint32_t> offset_buf;
 
-    if (tag.ssa_ref != NULL)
+    if (tag.is_inline())
     {
+        uint64_t w = (uint64_t)tag.ssa_ref;
+        uint32_t a = SSA_INLINE_A(w), b = SSA_INLINE_B(w);
+        if (w & SSA_INLINE_RANGE)
+            for (uint32_t o = a; o <= b; o++)
+                offset_buf.push_back(o);
+        else
+        {
+            offset_buf.push_back(a);
+            if (b != a)
+                offset_buf.push_back(b);
+        }
+    }
+    else if (tag.ssa_ref != NULL)
+    {
+        ssa_tag_wait(tag);
         uint8_t res[TAG_WIDTH];
         MTBDD leaf = mtbdd_enum_all_first(tag.ssa_ref->bdd, var_set, res, NULL);
         while (leaf != mtbdd_false)
@@ -339,21 +1496,23 @@ void ssa_lastcheck()
 {
     // 1.保存所有依然被引用的ssa到c_map
     c_map.clear();
-    auto it = ssa_blk_list.begin();
-    while (it != ssa_blk_list.end())
+    for (size_t b = 0; b < ssa_blk_cnt; b++)
     {
+        ssa *sp = ssa_blk_tab[b].sp;
+        if (sp == NULL)
+            continue;
         for (size_t i = 0; i < SSA_BLK; i++)
         {
-            if ((*it)[i].ref_count != 0 && (*it)[i].ref_count != 0xffffffffffffffff)
+            if (sp[i].ref_count != 0 && sp[i].ref_count != SSA_UNUSED && sp[i].ref_count != SSA_RESERVED)
             {
-                c_map.insert(std::pair<ssa *, uint64_t>(&(*it)[i], (*it)[i].ref_count));
+                c_map.insert(std::pair<ssa *, uint64_t>(&sp[i], sp[i].ref_count));
             }
         }
-        it++;
     }
 
     // 2.检查页表中所有非零的ssa_tag都指向了合法的ssa，并在c_map中去除这个引用
-    for (size_t tab_i = 0; tab_i < TOP_DIR_SZ; tab_i++)
+    std::set<tag_uniform_t *> u_set;
+    for (size_t tab_i = 0; tag_dir.table != NULL && tab_i < TOP_DIR_SZ; tab_i++)
     {
         if (tag_dir.table[tab_i])
         {
@@ -363,11 +1522,29 @@ void ssa_lastcheck()
                 if ((*table).page[pag_i])
                 {
                     tag_page_t *page = (*table).page[pag_i];
-                    for (size_t tag_i = 0; tag_i < PAGE_SIZE; tag_i++)
+                    size_t tag_n = PAGE_SIZE;
+                    //uniform页可能被多个页表项共享，但只持有一个引用
+                    if (PAGE_IS_UNIFORM(page))
+                    {
+                        if (!u_set.insert(PAGE2UNIFORM(page)).second)
+                            continue;
+                        tag_n = 1;
+                    }
+                    for (size_t tag_i = 0; tag_i < tag_n; tag_i++)
                     {
-                        if ((*page).tag[tag_i].ssa_ref != NULL)
+                        //直接读出ssa指针，不通过tag_slot_load增加引用
+                        ssa *p;
+                        if (PAGE_IS_UNIFORM(page))
+                            p = PAGE2UNIFORM(page)->tag.ssa_ref;
+                        else
+#if SSA_PAGE_PACKED
+                            p = ssa_slot_unpack((*page).tag[tag_i]);
+#else
+                            p = (*page).tag[tag_i].ssa_ref;
+#endif
+                        if (p != NULL && !((uint64_t)p & SSA_INLINE_BIT))
                         {
-                            auto it = c_map.find((*page).tag[tag_i].ssa_ref);
+                            auto it = c_map.find(p);
                             if (it == c_map.end())
                             {
                                 LOGD("error: page walk find ssa_tag point to empty ssa\n");
@@ -391,7 +1568,7 @@ void ssa_lastcheck()
         {
             for (size_t tag_i = 0; tag_i < TAGS_PER_GPR; tag_i++)
             {
-                if (threads_ctx[tid_i].vcpu.gpr[reg_i][tag_i].ssa_ref != NULL)
+                if (threads_ctx[tid_i].vcpu.gpr[reg_i][tag_i].holds_ssa())
                 {
                     auto it = c_map.find(threads_ctx[tid_i].vcpu.gpr[reg_i][tag_i].ssa_ref);
                     if (it == c_map.end())
@@ -408,6 +1585,26 @@ void ssa_lastcheck()
         }
     }
 
+    // 2.单元素tag表持有的引用
+    for (size_t top_i = 0; top_i < SSA_SINGLE_TOP; top_i++)
+    {
+        ssa *volatile *leaf = ssa_single_tab[top_i];
+        for (size_t i = 0; leaf != NULL && i < SSA_SINGLE_LEAF; i++)
+        {
+            ssa *s = leaf[i];
+            if (s == NULL)
+                continue;
+            auto it = c_map.find(s);
+            if (it == c_map.end())
+            {
+                LOGD("error: single table walk find ssa_tag point to empty ssa\n");
+                continue;
+            }
+            if (--(*it).first->ref_count == 0)
+                c_map.erase(it);
+        }
+    }
+
     // 3.检查c_map是否为空来判断一致性
     if (c_map.size() != 0)
     {
@@ -416,35 +1613,59 @@ void ssa_lastcheck()
 
     //打印统计信息
     uint64_t total_combine_wait = 0, total_alloc_wait = 0;
+    uint64_t total_mag_refill = 0, total_mag_refill_wait = 0;
     uint64_t total_cache_access = 0, total_cache_hit = 0;
+    uint64_t total_cache_miss = 0, total_cache_evict = 0;
     uint64_t total_tag_combine = 0, total_tag_alloc = 0;
     uint64_t total_cb_ll = 0, total_cb_lh = 0, total_cb_hh = 0;
     uint64_t total_bdd_cb = 0;
+    uint64_t total_intern_hit = 0, total_intern_miss = 0;
+    uint64_t total_bench_or = 0, total_bench_andnot = 0, total_bench_diff = 0;
     for (size_t tid_i = 0; tid_i < tctx_ct; tid_i++) // 128
     {
         LOGD("thread %lu:\n", tid_i);
         LOGD("\tcombine wait %lu,alloc wait %lu\n", ssa_tls[tid_i].ss[ss_combine_wait], ssa_tls[tid_i].ss[ss_alloc_wait]);
+        LOGD("\tmag refill %lu,mag refill wait %lu\n", ssa_tls[tid_i].ss[ss_mag_refill], ssa_tls[tid_i].ss[ss_mag_refill_wait]);
         LOGD("\tcache access %lu,cache hit %lu,hit rate %f\n", ssa_tls[tid_i].ss[ss_cache_access], ssa_tls[tid_i].ss[ss_cache_hit],
              (double)ssa_tls[tid_i].ss[ss_cache_hit] / (double)ssa_tls[tid_i].ss[ss_cache_access]);
-        LOGD("\ttag combine %lu,tag alloc %lu\n", ssa_tls[tid_i].ss[ss_combine], ssa_tls[tid_i].ss[ss_alloc]);
+        LOGD("\tcache miss %lu,cache evict %lu\n", ssa_tls[tid_i].ss[ss_cache_miss], ssa_tls[tid_i].ss[ss_cache_evict]);
+        LOGD("\ttag combine %lu,tag alloc %lu,alloc hit %lu\n", ssa_tls[tid_i].ss[ss_combine], ssa_tls[tid_i].ss[ss_alloc], ssa_tls[tid_i].ss[ss_alloc_hit]);
         LOGD("\tcb_ll %lu,cb_lh %lu,cb_hh %lu\n", ssa_tls[tid_i].ss[ss_cb_ll], ssa_tls[tid_i].ss[ss_cb_lh], ssa_tls[tid_i].ss[ss_cb_hh]);
         LOGD("\tbdd_cb %lu\n", ssa_tls[tid_i].ss[bdd_cb_count]);
         total_combine_wait += ssa_tls[tid_i].ss[ss_combine_wait];
         total_alloc_wait += ssa_tls[tid_i].ss[ss_alloc_wait];
+        total_mag_refill += ssa_tls[tid_i].ss[ss_mag_refill];
+        total_mag_refill_wait += ssa_tls[tid_i].ss[ss_mag_refill_wait];
         total_cache_access += ssa_tls[tid_i].ss[ss_cache_access];
         total_cache_hit += ssa_tls[tid_i].ss[ss_cache_hit];
+        total_cache_miss += ssa_tls[tid_i].ss[ss_cache_miss];
+        total_cache_evict += ssa_tls[tid_i].ss[ss_cache_evict];
         total_tag_combine += ssa_tls[tid_i].ss[ss_combine];
         total_tag_alloc += ssa_tls[tid_i].ss[ss_alloc];
         total_cb_ll += ssa_tls[tid_i].ss[ss_cb_ll];
         total_cb_lh += ssa_tls[tid_i].ss[ss_cb_lh];
         total_cb_hh += ssa_tls[tid_i].ss[ss_cb_hh];
         total_bdd_cb += ssa_tls[tid_i].ss[bdd_cb_count];
+        total_intern_hit += ssa_tls[tid_i].ss[ss_intern_hit];
+        total_intern_miss += ssa_tls[tid_i].ss[ss_intern_miss];
+        total_bench_or += ssa_tls[tid_i].ss[bdd_bench_or];
+        total_bench_andnot += ssa_tls[tid_i].ss[bdd_bench_andnot];
+        total_bench_diff += ssa_tls[tid_i].ss[bdd_bench_diff];
     }
     LOGD("total\n");
+    LOGD("\talloc statis: alloc wait %lu,mag refill %lu,mag refill wait %lu\n", total_alloc_wait, total_mag_refill, total_mag_refill_wait);
     LOGD("\tcache statis: access %lu,hit %lu,hit rate %f\n", total_cache_access, total_cache_hit, (double)total_cache_hit / (double)total_cache_access);
+    LOGD("\tcache statis: miss %lu,evict %lu,%d sets x %d ways\n", total_cache_miss, total_cache_evict, SSA_CB_CACHE_SETS, SSA_CB_CACHE_WAYS);
     //LOGD("\ttaint op statis: combine %lu,alloc %lu,transfer %lu\n", total_tag_combine, total_tag_alloc, ss_transfer);
     //LOGD("\tcombine type statis: cb_ll %lu,cb_lh %lu,cb_hh %lu\n", total_cb_ll, total_cb_lh, total_cb_hh);
     LOGD("\tbdd_cb_count:%lu\n", total_bdd_cb);
+    LOGD("\tintern statis: hit %lu,miss %lu,dedup ratio %f\n", total_intern_hit, total_intern_miss,
+         (double)total_intern_hit / (double)(total_intern_hit + total_intern_miss));
+#if SSA_BENCH_OR
+    //同一批合并请求上sylvan_or_alone与not/and/not的耗时对比
+    LOGD("\tor bench: or %lu cycles,not/and/not %lu cycles,speedup %f,diff %lu\n", total_bench_or, total_bench_andnot,
+         (double)total_bench_andnot / (double)total_bench_or, total_bench_diff);
+#endif
 }
 #endif
 
@@ -458,22 +1679,35 @@ static void profile_thread(void *arg)
         uint64_t inuse_ssa = 0;
         uint64_t unused_ssa = 0;
         uint64_t unalloced_ssa = 0;
-        auto it = ssa_blk_list.begin();
-        while (it != ssa_blk_list.end())
+        uint64_t free_ssa_count = 0;
+        for (size_t b = 0; b < ssa_blk_cnt; b++)
         {
+            ssa *sp = ssa_blk_tab[b].sp;
+            if (sp == NULL)
+                continue;
             total_ssa += SSA_BLK;
             for (size_t i = 0; i < SSA_BLK; i++)
             {
-                if ((*it)[i].ref_count == 0)
+                if (sp[i].ref_count == 0)
                     unused_ssa++;
-                else if ((*it)[i].ref_count == 0xffffffffffffffff)
+                else if (sp[i].ref_count == SSA_UNUSED)
                     unalloced_ssa++;
+                else if (sp[i].ref_count == SSA_RESERVED)
+                    free_ssa_count++;
                 else
                     inuse_ssa++;
             }
-            it++;
         }
-        LOGD("ssa profile: total ssa %lu,insuse_ssa %lu,unused ssa %lu,unalloced_ssa %lu,ssa blk: %lu\n", total_ssa, inuse_ssa, unused_ssa, unalloced_ssa, ssa_blk_list.size());
+        LOGD("ssa profile: total ssa %lu,insuse_ssa %lu,unused ssa %lu,unalloced_ssa %lu,free ssa %lu,ssa blk: %lu\n", total_ssa, inuse_ssa, unused_ssa, unalloced_ssa, free_ssa_count, ssa_blk_live);
+        //intern命中的次数即因共享而少用的ssa数量
+        uint64_t intern_hit = 0, intern_miss = 0;
+        for (size_t tid_i = 0; tid_i < tctx_ct; tid_i++)
+        {
+            intern_hit += ssa_tls[tid_i].ss[ss_intern_hit];
+            intern_miss += ssa_tls[tid_i].ss[ss_intern_miss];
+        }
+        LOGD("intern profile: hit %lu,miss %lu,dedup ratio %f\n", intern_hit, intern_miss,
+             (double)intern_hit / (double)(intern_hit + intern_miss));
     }
     profile_exit = false;
 }
@@ -488,11 +1722,17 @@ void ssa_init()
     sylvan_set_limits(SYLVAN_MEMORY_LIMIT, 1, 5);
     sylvan_init_package();
     sylvan_init_mtbdd();
+    sylvan_gc_add_mark(TASK(ssa_gc_mark));
+#if SSA_INLINE_OPS
+    sylvan_gc_hook_pregc(TASK(ssa_inline_pregc));
+    sylvan_gc_hook_postgc(TASK(ssa_inline_postgc));
+#endif
 
     // 2 var_set,use tmp tls block
     sylvan_tcb_t tmp_tls;
     tmp_tls.slots[my_region_slot] = -1;
     tmp_tls.slots[my_worker_id_slot] = 0;
+    tmp_tls.slots[inline_abort_slot] = 0;
     lace_n_workers_id = 1;
     uint64_t old_fs = _readfsbase_u64();
     _writefsbase_u64((uint64_t)&tmp_tls);
@@ -505,17 +1745,42 @@ void ssa_init()
     }
     //该操作应该不会导致gc，因此此时没有worker thread也没关系
     var_set = mtbdd_set_from_array((uint32_t *)&array, TAG_WIDTH);
+    for (size_t i = 0; i < TAG_WIDTH; i++)
+    {
+        var_order[i] = VAR_ORDER;
+    }
     _writefsbase_u64(old_fs);
     lace_n_workers_id = 0;
     mfence();
     // 3 ssa_tls
     ssa_tls = (ssa_tls_t *)memalign(LINE_SIZE, sizeof(ssa_tls_t) * THREAD_CTX_BLK);
+    //gc会检查所有线程的inline_busy，包括尚未启动的线程
+    memset((void *)ssa_tls, 0, sizeof(ssa_tls_t) * THREAD_CTX_BLK);
 
     // 2.2 free_ssa
     free_ssa._q = (ssa **)malloc(sizeof(ssa *) * SSA_BLK);
     free_ssa._h = 0;
     free_ssa._t = 0;
     free_ssa.gc_lock = 0;
+    ssa_blk_cap = SSA_BLK_INIT;
+    ssa_blk_tab = (ssa_blk_t *)calloc(ssa_blk_cap, sizeof(ssa_blk_t));
+    ssa_blk_cnt = 0;
+    ssa_blk_live = 0;
+    ssa_free_est = 0;
+    gc_cur_blk = 0;
+    gc_cur_i = 0;
+    ssa_intern_tab = (ssa *volatile *)calloc((size_t)1 << SSA_INTERN_BITS, sizeof(ssa *));
+#if SSA_PAGE_PACKED
+    //其余部分已经初始化，失败时libdft_die调用的ssa_exit可以正常清理
+    ssa_region = (ssa *)mmap(NULL, sizeof(ssa) * SSA_BLK * SSA_REGION_BLKS, PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (ssa_region == MAP_FAILED)
+    {
+        fprintf(log_fd, "error: failed to reserve the ssa region\n");
+        libdft_die();
+        abort();
+    }
+#endif
     add_ssa_blk();
 
 #ifdef SSA_PROFILE_GC
@@ -539,32 +1804,80 @@ void ssa_exit()
     sylvan_quit();
     free(ssa_tls);
 
-    auto it = ssa_blk_list.begin();
-    while (it != ssa_blk_list.end())
-    {
-        free(*it);
-        it++;
-    }
+#if SSA_PAGE_PACKED
+    munmap((void *)ssa_region, sizeof(ssa) * SSA_BLK * SSA_REGION_BLKS);
+#else
+    for (size_t b = 0; b < ssa_blk_cnt; b++)
+        free(ssa_blk_tab[b].sp);
+#endif
+    free(ssa_blk_tab);
     free(free_ssa._q);
+    free((void *)ssa_intern_tab);
+    for (size_t top_i = 0; top_i < SSA_SINGLE_TOP; top_i++)
+        free((void *)ssa_single_tab[top_i]);
 }
 
 void ssa_thread_start(uint64_t tid)
 {
     ssa_tls_t *tls = &ssa_tls[tid];
     memset((void *)tls, 0, sizeof(ssa_tls_t));
+    tls->mag = (ssa **)malloc(sizeof(ssa *) * SSA_MAG_SIZE);
+    tls->inflight = (ssa_tag *)calloc(SSA_RING_SIZE * 3, sizeof(ssa_tag));
+    tls->cb_cache = (ssa_cb_entry *)calloc(SSA_CB_CACHE_SETS * SSA_CB_CACHE_WAYS, sizeof(ssa_cb_entry));
+    if (tls->cb_cache == NULL)
+    {
+        fprintf(log_fd, "error: failed to allocate the combine cache\n");
+        libdft_die();
+        abort(); //libdft_die只是detach，ssa_cb_set会访问cb_cache
+    }
+    tls->pairs = (SSA_Pairs *)calloc(1, sizeof(SSA_Pairs));
     tls->t = lace_spawn_worker((void *)&tls->quit);
 }
 
 void ssa_thread_fini(uint64_t tid)
 {
     ssa_tls_t *t = &ssa_tls[tid];
+#if SSA_ASYNC_COMBINE
+    // worker退出前必须完成ring中的请求
+    ssa_ring_drain(t);
+#ifdef SSA_PROFILE
+    ssa_tls_t *tls = t;
+    SS_ADD(bdd_cb_count, t->t->cb_count);
+#endif
+#endif
+#if defined(SSA_PROFILE) && SSA_BENCH_OR
+    {
+        ssa_tls_t *tls = t;
+        SS_ADD(bdd_bench_or, t->t->bench_or);
+        SS_ADD(bdd_bench_andnot, t->t->bench_andnot);
+        SS_ADD(bdd_bench_diff, t->t->bench_diff);
+    }
+#endif
+    free(t->inflight);
     t->quit = true;
+    lace_ssa_kick(t->t);
     while (t->quit)
         ;
-    // ssa_tag除了存在于page table和reg中，还临时存在于cb_caches中
-    t->cb_cache_l.~ssa_tag();
-    t->cb_cache_r.~ssa_tag();
-    t->cb_cache_v.~ssa_tag();
+    // ssa_tag除了存在于page table和reg中，还临时存在于cb_cache中
+    for (size_t i = 0; i < SSA_CB_CACHE_SETS * SSA_CB_CACHE_WAYS; i++)
+    {
+        t->cb_cache[i].l.~ssa_tag();
+        t->cb_cache[i].r.~ssa_tag();
+        t->cb_cache[i].v.~ssa_tag();
+    }
+    free(t->cb_cache);
+    free(t->batch);
+    // magazine中剩余的ssa不被ssa_gc_mark标记，标记为从未使用，由之后的gc重新回收
+    for (uint64_t i = 0; i < t->mag_n; i++)
+        t->mag[i]->ref_count = SSA_UNUSED;
+    free(t->mag);
+    SSA_Pairs *pairs = t->pairs;
+    t->pairs = NULL;
+    mfence();
+    //等待正在标记的sylvan gc离开pairs
+    while (ssa_marking != 0)
+        ;
+    free(pairs);
 }
 
 #else
@@ -575,6 +1888,10 @@ void ssa_exit() { return; }
 void ssa_thread_start(uint64_t tid) { return; }
 void ssa_thread_fini(uint64_t tid) { return; }
 ssa_tag ssa_tag_alloc(unsigned int offset, uint64_t tid) { return ssa_tag(); }
+void ssa_tag_alloc_n(ssa_tag *tags, unsigned int offset, size_t n, uint64_t tid) { return; }
+ssa_tag ssa_tag_alloc_range(unsigned int begin, unsigned int end, uint64_t tid) { return ssa_tag(); }
 ssa_tag ssa_tag_combine(ssa_tag const &lhs, ssa_tag const &rhs, uint64_t tid) { return ssa_tag(); }
+ssa_tag ssa_tag_combine_n(ssa_tag const *tags, size_t n, uint64_t tid) { return ssa_tag(); }
+void ssa_tag_combine_v(ssa_tag *dst, ssa_tag const *lhs, ssa_tag const *rhs, size_t n, uint64_t tid) { return; }
 std::string ssa_tag_print(ssa_tag const &tag) { return nullptr; }
 #endif
\ No newline at end of file
@@ -14,13 +14,47 @@ class ssa
 public:
     uint64_t ref_count;
     uint64_t bdd;
+    ssa *next; //intern表中同一个桶内的下一个ssa
+    uint64_t size; //bdd节点数的估计，决定合并是否并行执行
     ssa()
     {
         ref_count = 0;
         bdd = 0; // mtbdd_false
+        next = NULL;
+        size = 0;
     }
 };
 
+/*
+intern之后同一个ssa被不同线程的tag共享，引用计数只能原子地修改
+*/
+static inline void ssa_ref_inc(ssa *s)
+{
+    __sync_fetch_and_add(&s->ref_count, 1);
+}
+
+static inline void ssa_ref_dec(ssa *s)
+{
+    __sync_fetch_and_sub(&s->ref_count, 1);
+}
+
+/*
+小集合直接存放在ssa_ref中，不分配ssa。ssa按8字节对齐，最低位为1时ssa_ref不是
+指针：SSA_INLINE_RANGE置位时是区间[a, b]（b - a >= 2），否则是{a, b}（a <= b，
+a == b时是单元素集合）。a占TAG_WIDTH位，其后是b - a，整个编码不超过32位，
+可以直接存入压缩的tag页（见SSA_PAGE_PACKED）
+*/
+#define SSA_INLINE_BIT 0x1ULL
+#define SSA_INLINE_RANGE 0x2ULL
+#define SSA_INLINE_SHIFT_A 2
+#define SSA_INLINE_SHIFT_D (SSA_INLINE_SHIFT_A + TAG_WIDTH)
+#define SSA_INLINE_SPAN (1U << (32 - SSA_INLINE_SHIFT_D)) //b - a < SSA_INLINE_SPAN
+#define SSA_INLINE_MASK ((1ULL << TAG_WIDTH) - 1)
+#define SSA_INLINE_A(w) (((w) >> SSA_INLINE_SHIFT_A) & SSA_INLINE_MASK)
+#define SSA_INLINE_B(w) (SSA_INLINE_A(w) + (((w) >> SSA_INLINE_SHIFT_D) & (SSA_INLINE_SPAN - 1)))
+#define SSA_INLINE_MAKE(a, b, range) \
+    ((ssa *)(SSA_INLINE_BIT | ((range) ? SSA_INLINE_RANGE : 0) | (uint64_t)(a) << SSA_INLINE_SHIFT_A | (uint64_t)((b) - (a)) << SSA_INLINE_SHIFT_D))
+
 class ssa_tag
 {
 public:
@@ -30,10 +64,21 @@ public:
 
     ssa_tag(ssa *ref) : ssa_ref(ref){};
 
+    inline bool is_inline() const
+    {
+        return ((uint64_t)ssa_ref & SSA_INLINE_BIT) != 0;
+    }
+
+    //ssa_ref指向真正的ssa，只有这时才需要维护引用计数
+    inline bool holds_ssa() const
+    {
+        return ssa_ref != NULL && !is_inline();
+    }
+
     ssa_tag(const ssa_tag &rhs)
     {
-        if (rhs.ssa_ref != NULL)
-            rhs.ssa_ref->ref_count++;//__sync_add_and_fetch(&(*rhs.ssa_ref).ref_count, 1);
+        if (rhs.holds_ssa())
+            ssa_ref_inc(rhs.ssa_ref);
         ssa_ref = rhs.ssa_ref;
     }
 
@@ -45,8 +90,8 @@ public:
 
     ~ssa_tag()
     {
-        if (this->ssa_ref != NULL)
-            ssa_ref->ref_count--;//__sync_sub_and_fetch(&(*ssa_ref).ref_count, 1);
+        if (this->holds_ssa())
+            ssa_ref_dec(ssa_ref);
         this->ssa_ref = NULL;
     }
 
@@ -55,10 +100,10 @@ public:
 #ifdef TAINT_PROFILE
         uint64_t pre = __rdtsc();
 #endif
-        if (rhs.ssa_ref != NULL)
-            rhs.ssa_ref->ref_count++;//__sync_add_and_fetch(&(*rhs.ssa_ref).ref_count, 1);
-        if (this->ssa_ref != NULL)
-            ssa_ref->ref_count--;//__sync_sub_and_fetch(&(*ssa_ref).ref_count, 1);
+        if (rhs.holds_ssa())
+            ssa_ref_inc(rhs.ssa_ref);
+        if (this->holds_ssa())
+            ssa_ref_dec(ssa_ref);
         ssa_ref = rhs.ssa_ref;
 #ifdef TAINT_PROFILE
         move_time += __rdtsc() - pre;
@@ -74,8 +119,8 @@ public:
 #ifdef TAINT_PROFILE
         uint64_t pre = __rdtsc();
 #endif
-        if (this->ssa_ref != NULL)
-            ssa_ref->ref_count--;//__sync_sub_and_fetch(&(*ssa_ref).ref_count, 1);
+        if (this->holds_ssa())
+            ssa_ref_dec(ssa_ref);
         ssa_ref = rhs.ssa_ref;
         rhs.ssa_ref = NULL;
 #ifdef TAINT_PROFILE
@@ -87,14 +132,52 @@ public:
         return *this;
     }
 
+    /*
+    相同的集合共享同一个ssa（见ssa_tag_gc.cpp中的intern表），只比较指针。
+    异步合并的结果在完成之前无法intern，可能与已有的ssa重复，此时视为不相等。
+    内联的集合按值比较；bdd合并的结果即使能够内联也仍然放在ssa中，同样视为不相等
+    */
     inline bool operator==(const ssa_tag &rhs) const
     {
-        if (ssa_ref == rhs.ssa_ref)
-            return true;
-        if (ssa_ref == NULL || rhs.ssa_ref == NULL)
-            return false;
-        if (ssa_ref->bdd == rhs.ssa_ref->bdd)
-            return true;
-        return false;
+        return ssa_ref == rhs.ssa_ref;
     }
-};
\ No newline at end of file
+};
+
+#if SSA_PAGE_PACKED
+/*
+压缩tag页中的一项（tag_page_traits<ssa_tag>）：0为空，最低位为1时是内联的集合
+本身，否则是ssa在ssa_region中的下标加1再左移一位。所有ssa块都位于ssa_region中，
+转换不需要查表。一项与ssa_tag一样持有ssa的引用
+*/
+extern ssa *ssa_region;
+
+static inline uint32_t ssa_slot_pack(ssa *p)
+{
+    if (p == NULL || ((uint64_t)p & SSA_INLINE_BIT))
+        return (uint32_t)(uint64_t)p;
+    return (uint32_t)(p - ssa_region + 1) << 1;
+}
+
+static inline ssa *ssa_slot_unpack(uint32_t v)
+{
+    if (v == 0 || (v & SSA_INLINE_BIT))
+        return (ssa *)(uint64_t)v;
+    return ssa_region + (v >> 1) - 1;
+}
+
+static inline ssa_tag ssa_slot_load(uint32_t v)
+{
+    ssa_tag t(ssa_slot_unpack(v));
+    if (t.holds_ssa())
+        ssa_ref_inc(t.ssa_ref);
+    return t;
+}
+
+static inline void ssa_slot_store(uint32_t &v, ssa_tag const &tag)
+{
+    ssa_tag old(ssa_slot_unpack(v)); //接管原来的引用，离开作用域时释放
+    if (tag.holds_ssa())
+        ssa_ref_inc(tag.ssa_ref);
+    v = ssa_slot_pack(tag.ssa_ref);
+}
+#endif
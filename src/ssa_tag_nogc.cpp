@@ -17,16 +17,40 @@ extern FILE *log_fd;
 
 typedef struct
 {
-    ssa_tag cb_cache_l;
-    ssa_tag cb_cache_r;
-    ssa_tag cb_cache_v;
+    ssa_tag l;
+    ssa_tag r;
+    ssa_tag v;
+} ssa_cb_entry;
+
+typedef struct
+{
+    ssa_cb_entry *cb_cache; //SSA_CB_CACHE_SETS组，每组SSA_CB_CACHE_WAYS路，组内按最近使用排序
     int volatile quit;
     SSA_Task *t;
-    uint64_t pading[3];
+    void **batch;
+    uint64_t pading[4];
 } ssa_tls_t;
 
 ssa_tls_t *ssa_tls;
 BDD var_set;
+uint8_t var_order[TAG_WIDTH];
+
+/*
+执行t上类型为type的请求。SSA_INLINE_OPS下直接在本线程上执行，nogc模式没有
+sylvan gc，不需要与gc互斥；唯一表满时交给worker，由它报错退出
+*/
+static inline void ssa_task_run(SSA_Task *t, uint64_t type)
+{
+#if SSA_INLINE_OPS
+    if (lace_ssa_inline(t, type))
+        return;
+#endif
+    mfence();
+    t->task_type = type;
+    lace_ssa_kick(t);
+    while(t->task_type!=0)
+        ;
+}
 
 ssa_tag ssa_tag_alloc(unsigned int offset, uint64_t tid)
 {
@@ -42,13 +66,99 @@ ssa_tag ssa_tag_alloc(unsigned int offset, uint64_t tid)
     }
     t->arg1 = var_set;
     t->arg2 = (uint64_t)array;
-    mfence();
-    t->task_type = 1;
-    while(t->task_type!=0)
-    ;
+    ssa_task_run(t, 1);
+    return t->res;
+}
+
+void ssa_tag_alloc_n(ssa_tag *tags, unsigned int offset, size_t n, uint64_t tid)
+{
+    ssa_tls_t *tls = &ssa_tls[tid];
+    if (unlikely(tls->batch == NULL))
+    {
+        tls->batch = (void **)malloc(sizeof(void *) * SSA_ALLOC_BATCH);
+        if (tls->batch == NULL)
+        {
+            fprintf(log_fd, "error: failed to allocate the tag batch\n");
+            libdft_die();
+            abort(); //libdft_die只是detach，下面会写入batch
+        }
+    }
+    SSA_Task *t = tls->t;
+    while (n > 0)
+    {
+        uint64_t count = n < SSA_ALLOC_BATCH ? n : SSA_ALLOC_BATCH;
+        for (uint64_t i = 0; i < count; i++)
+            tls->batch[i] = &tags[i];
+        SSA_Batch b;
+        b.offset = offset;
+        b.count = count;
+        b.order = var_order;
+        b.width = TAG_WIDTH;
+        b.dst = tls->batch;
+        b.dst_off = 0;
+        t->arg1 = var_set;
+        t->arg2 = (uint64_t)&b;
+        ssa_task_run(t, 3);
+        tags += count;
+        offset += count;
+        n -= count;
+    }
+}
+
+//为输入偏移区间[begin, end)直接构造一个bdd
+ssa_tag ssa_tag_alloc_range(unsigned int begin, unsigned int end, uint64_t tid)
+{
+    if (end <= begin)
+        return 0;
+    ssa_tls_t *tls = &ssa_tls[tid];
+    SSA_Task *t = tls->t;
+    SSA_Range r;
+    r.lo = begin;
+    r.hi = end - 1;
+    r.order = var_order;
+    t->arg1 = var_set;
+    t->arg2 = (uint64_t)&r;
+    ssa_task_run(t, 4);
     return t->res;
 }
 
+//合并满足交换律，l与r排序后再查找和插入
+static inline ssa_cb_entry *ssa_cb_set(ssa_tls_t *tls, ssa_tag &l, ssa_tag &r)
+{
+    if (l > r)
+        std::swap(l, r);
+    uint64_t h = l * 0x9e3779b97f4a7c15 ^ r * 0xc2b2ae3d27d4eb4f;
+    return &tls->cb_cache[((h >> 32) & (SSA_CB_CACHE_SETS - 1)) * SSA_CB_CACHE_WAYS];
+}
+
+//在组中查找，命中的项移到第0路
+static inline bool ssa_cb_lookup(ssa_cb_entry *set, ssa_tag l, ssa_tag r, ssa_tag &v)
+{
+    for (int w = 0; w < SSA_CB_CACHE_WAYS; w++)
+    {
+        if (set[w].l == l && set[w].r == r)
+        {
+            ssa_cb_entry e = set[w];
+            for (; w > 0; w--)
+                set[w] = set[w - 1];
+            set[0] = e;
+            v = e.v;
+            return true;
+        }
+    }
+    return false;
+}
+
+//插入到第0路，最后一路被淘汰
+static inline void ssa_cb_insert(ssa_cb_entry *set, ssa_tag l, ssa_tag r, ssa_tag v)
+{
+    for (int w = SSA_CB_CACHE_WAYS - 1; w > 0; w--)
+        set[w] = set[w - 1];
+    set[0].l = l;
+    set[0].r = r;
+    set[0].v = v;
+}
+
 ssa_tag ssa_tag_combine(ssa_tag const &lhs, ssa_tag const &rhs, uint64_t tid)
 {
     if (lhs == 0)
@@ -57,27 +167,123 @@ ssa_tag ssa_tag_combine(ssa_tag const &lhs, ssa_tag const &rhs, uint64_t tid)
         return lhs;
 
     ssa_tls_t *tls = &ssa_tls[tid];
-    if (tls->cb_cache_l == lhs && tls->cb_cache_r == rhs)
-    {
-        return tls->cb_cache_v;
-    }
+    ssa_tag l = lhs, r = rhs;
+    ssa_cb_entry *set = ssa_cb_set(tls, l, r);
+    ssa_tag v;
+    if (ssa_cb_lookup(set, l, r, v))
+        return v;
 
     SSA_Task *t = tls->t;
     t->arg1 = lhs;
     t->arg2 = rhs;
-    mfence();
-    t->task_type = 2;
-    while(t->task_type!=0)
-        ;
+    ssa_task_run(t, 2);
         
     BDD res = t->res;
-
-    ssa_tls[tid].cb_cache_l = lhs;
-    ssa_tls[tid].cb_cache_r = rhs;
-    ssa_tls[tid].cb_cache_v = res;
+    ssa_cb_insert(set, l, r, res);
     return res;
 }
 
+//按通道合并，dst[i] = lhs[i] ∪ rhs[i]，重复的通道对只计算一次，cache未命中的通道对放入同一个请求
+void ssa_tag_combine_v(ssa_tag *dst, ssa_tag const *lhs, ssa_tag const *rhs, size_t n, uint64_t tid)
+{
+    ssa_tls_t *tls = &ssa_tls[tid];
+    while (n > 0)
+    {
+        size_t k = n < SSA_VEC_MAX ? n : SSA_VEC_MAX;
+        ssa_tag res[SSA_VEC_MAX];
+        int same[SSA_VEC_MAX];
+        ssa_cb_entry *mset[SSA_VEC_MAX];
+        size_t mlane[SSA_VEC_MAX];
+        SSA_Pairs p;
+        p.count = 0;
+        for (size_t i = 0; i < k; i++)
+        {
+            same[i] = -1;
+            ssa_tag l = lhs[i], r = rhs[i];
+            if (l == 0 || r == 0 || l == r)
+            {
+                res[i] = l == 0 ? r : l;
+                continue;
+            }
+            size_t j = 0;
+            while (j < i && !((lhs[j] == l && rhs[j] == r) || (lhs[j] == r && rhs[j] == l)))
+                j++;
+            if (j < i)
+            {
+                same[i] = j;
+                continue;
+            }
+            ssa_cb_entry *set = ssa_cb_set(tls, l, r);
+            if (ssa_cb_lookup(set, l, r, res[i]))
+                continue;
+            mset[p.count] = set;
+            mlane[p.count] = i;
+            p.l[p.count] = l;
+            p.r[p.count] = r;
+            p.count++;
+        }
+        if (p.count > 0)
+        {
+            SSA_Task *t = tls->t;
+            t->arg2 = (uint64_t)&p;
+            ssa_task_run(t, 6);
+            for (uint64_t m = 0; m < p.count; m++)
+            {
+                res[mlane[m]] = p.res[m];
+                ssa_cb_insert(mset[m], p.l[m], p.r[m], p.res[m]);
+            }
+        }
+        for (size_t i = 0; i < k; i++)
+            dst[i] = same[i] >= 0 ? res[same[i]] : res[i];
+        dst += k;
+        lhs += k;
+        rhs += k;
+        n -= k;
+    }
+}
+
+//合并tags[0..n)，去掉空tag和重复的tag后每SSA_UNION_MAX个操作数发送一次n元合并请求
+ssa_tag ssa_tag_combine_n(ssa_tag const *tags, size_t n, uint64_t tid)
+{
+    ssa_tls_t *tls = &ssa_tls[tid];
+    ssa_tag acc = 0;
+    SSA_Union u;
+    size_t i = 0;
+    while (i < n)
+    {
+        uint64_t k = 0;
+        if (acc != 0)
+            u.ops[k++] = acc;
+        for (; i < n && k < SSA_UNION_MAX; i++)
+        {
+            if (tags[i] == 0)
+                continue;
+            uint64_t j = 0;
+            while (j < k && u.ops[j] != tags[i])
+                j++;
+            if (j == k)
+                u.ops[k++] = tags[i];
+        }
+        if (k < 2)
+        {
+            if (k == 1)
+                acc = u.ops[0];
+            continue;
+        }
+        if (k == 2)
+        {
+            acc = ssa_tag_combine(u.ops[0], u.ops[1], tid);
+            continue;
+        }
+        u.count = k;
+        SSA_Task *t = tls->t;
+        t->arg2 = (uint64_t)&u;
+        ssa_task_run(t, 5);
+        acc = t->res;
+    }
+    return acc;
+}
+
 std::string ssa_tag_print(ssa_tag const &tag)
 {
     std::string ss = "";
@@ -129,6 +335,7 @@ void ssa_init()
     sylvan_tcb_t tmp_tls;
     tmp_tls.slots[my_region_slot] = -1;
     tmp_tls.slots[my_worker_id_slot] = 0;
+    tmp_tls.slots[inline_abort_slot] = 0;
     lace_n_workers_id = 1;
     uint64_t old_fs = _readfsbase_u64();
     _writefsbase_u64((uint64_t)&tmp_tls);
@@ -139,6 +346,10 @@ void ssa_init()
         array[i] = i;
     }
     var_set = mtbdd_set_from_array((uint32_t *)&array, TAG_WIDTH);
+    for (size_t i = 0; i < TAG_WIDTH; i++)
+    {
+        var_order[i] = VAR_ORDER;
+    }
     _writefsbase_u64(old_fs);
     lace_n_workers_id = 0;
     mfence();
@@ -157,6 +368,13 @@ void ssa_thread_start(uint64_t tid)
 {
     ssa_tls_t *tls = &ssa_tls[tid];
     memset((void *)tls, 0, sizeof(ssa_tls_t));
+    tls->cb_cache = (ssa_cb_entry *)calloc(SSA_CB_CACHE_SETS * SSA_CB_CACHE_WAYS, sizeof(ssa_cb_entry));
+    if (tls->cb_cache == NULL)
+    {
+        fprintf(log_fd, "error: failed to allocate the combine cache\n");
+        libdft_die();
+        abort(); //libdft_die只是detach，ssa_cb_set会访问cb_cache
+    }
     tls->t = lace_spawn_worker((void *)&tls->quit);
 }
 
@@ -164,8 +382,11 @@ void ssa_thread_fini(uint64_t tid)
 {
     ssa_tls_t *t = &ssa_tls[tid];
     t->quit = true;
+    lace_ssa_kick(t->t);
     while (t->quit)
         ;
+    free(t->batch);
+    free(t->cb_cache);
 }
 
 #else
@@ -174,6 +395,10 @@ void ssa_exit() { return; }
 void ssa_thread_start(uint64_t tid) { return; }
 void ssa_thread_fini(uint64_t tid) { return; }
 ssa_tag ssa_tag_alloc(unsigned int offset, uint64_t tid) { return ssa_tag(); }
+void ssa_tag_alloc_n(ssa_tag *tags, unsigned int offset, size_t n, uint64_t tid) { return; }
+ssa_tag ssa_tag_alloc_range(unsigned int begin, unsigned int end, uint64_t tid) { return ssa_tag(); }
 ssa_tag ssa_tag_combine(ssa_tag const &lhs, ssa_tag const &rhs, uint64_t tid) { return ssa_tag(); }
+ssa_tag ssa_tag_combine_n(ssa_tag const *tags, size_t n, uint64_t tid) { return ssa_tag(); }
+void ssa_tag_combine_v(ssa_tag *dst, ssa_tag const *lhs, ssa_tag const *rhs, size_t n, uint64_t tid) { return; }
 std::string ssa_tag_print(ssa_tag const &tag) { return nullptr; }
 #endif
\ No newline at end of file
@@ -31,6 +31,19 @@ static inline void add_fuzzing_fd(int fd) {
 
 static inline void remove_fuzzing_fd(int fd) { fuzzing_fd_set.erase(fd); }
 
+/*
+ * taint [buf, buf + n) as input offsets [off, off + n); with TAINT_COARSE
+ * the whole buffer shares one range tag instead of one tag per byte
+ */
+static inline void taint_source(ADDRINT buf, size_t n, unsigned int off,
+                                THREADID tid) {
+#ifdef TAINT_COARSE
+  tagmap_setn_range(buf, n, off, tid);
+#else
+  tagmap_setn_offsets(buf, n, off, tid);
+#endif
+}
+
 /* __NR_open post syscall hook */
 static void post_open_hook(THREADID tid, syscall_ctx_t *ctx) {
   const int fd = ctx->ret;
@@ -123,11 +136,7 @@ static void post_read_hook(THREADID tid, syscall_ctx_t *ctx) {
       count = nr + 32;
     }
 
-    for (unsigned int i = 0; i < count; i++) {
-      tag_t t = tag_alloc<tag_t>(read_off + i,tid);//useless,just make compiler happy
-      tagmap_setb(buf + i, t);
-      // LOGD("[read] %d, lb: %d,  %s\n", i, t, tag_sprint(t).c_str());
-    }
+    taint_source(buf, count, read_off, tid);
 
     //tagmap_setb_reg(tid, DFT_REG_RAX, 0, BDD_LEN_LB);//just make compiler happy, we don't consider len tag
 
@@ -155,10 +164,7 @@ static void post_pread64_hook(THREADID tid, syscall_ctx_t *ctx) {
       count = nr + 32;
     }
     /* set the tag markings */
-    for (unsigned int i = 0; i < count; i++) {
-      tag_t t = tag_alloc<tag_t>(read_off + i,tid);//useless,just make compiler happy
-      tagmap_setb(buf + i, t);
-    }
+    taint_source(buf, count, read_off, tid);
   } else {
     /* clear the tag markings */
     tagmap_clrn(buf, count);
@@ -183,10 +189,7 @@ static void post_mmap_hook(THREADID tid, syscall_ctx_t *ctx) {
   if (is_fuzzing_fd(fd)) {
     tainted = true;
     LOGD("[mmap] fd: %d, offset: %ld, size: %lu\n", fd, read_off, nr);
-    for (unsigned int i = 0; i < nr; i++) {
-      tag_t t = tag_alloc<tag_t>(read_off + i,tid);//useless,just make compiler happy
-      tagmap_setb(buf + i, t);
-    }
+    taint_source(buf, nr, read_off, tid);
   } else {
     tagmap_clrn(buf, nr);
   }
@@ -0,0 +1,190 @@
+#ifndef __TAG_BITS_H__
+#define __TAG_BITS_H__
+
+/*
+ * kernels for boolean tags (TAG_UINT8): byte tags of registers and bitmaps
+ * of tag pages, one bit per guest byte. The AVX2 paths are taken when the
+ * tool is built with -mavx2; otherwise a 64-bit word carries 8 byte tags
+ * or 64 bits at a time
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __AVX2__
+/*
+ * GCC vector types and builtins rather than <immintrin.h>, whose inline
+ * definitions clash with the ones ssa_tag.h and sylvan_tls.h provide
+ */
+typedef char tag_v32qi __attribute__((vector_size(32)));
+typedef int tag_v8si __attribute__((vector_size(32)));
+typedef long long tag_v4di __attribute__((vector_size(32)));
+
+static inline tag_v32qi tag_v32_load(void const *p) {
+  tag_v32qi v;
+  memcpy(&v, p, 32);
+  return v;
+}
+
+static inline bool tag_v32_zero(tag_v32qi v) {
+  return __builtin_ia32_ptestz256((tag_v4di)v, (tag_v4di)v);
+}
+#endif
+
+#define TAG_BYTES_LSB 0x0101010101010101ULL
+
+/* true if tags[0..n) are all zero */
+static inline bool tag_bytes_clean(uint8_t const *tags, size_t n) {
+  size_t i = 0;
+#ifdef __AVX2__
+  for (; i + 32 <= n; i += 32)
+    if (!tag_v32_zero(tag_v32_load(tags + i)))
+      return false;
+#endif
+  uint64_t acc = 0;
+  for (; i + 8 <= n; i += 8) {
+    uint64_t w;
+    memcpy(&w, tags + i, 8);
+    acc |= w;
+  }
+  for (; i < n; i++)
+    acc |= tags[i];
+  return acc == 0;
+}
+
+/* dst[i] = lhs[i] | rhs[i] for i in [0, n); dst may be lhs or rhs */
+static inline void tag_bytes_or(uint8_t *dst, uint8_t const *lhs,
+                                uint8_t const *rhs, size_t n) {
+  size_t i = 0;
+#ifdef __AVX2__
+  for (; i + 32 <= n; i += 32) {
+    tag_v32qi v = tag_v32_load(lhs + i) | tag_v32_load(rhs + i);
+    memcpy(dst + i, &v, 32);
+  }
+#endif
+  for (; i + 8 <= n; i += 8) {
+    uint64_t l, r;
+    memcpy(&l, lhs + i, 8);
+    memcpy(&r, rhs + i, 8);
+    l |= r;
+    memcpy(dst + i, &l, 8);
+  }
+  for (; i < n; i++)
+    dst[i] = lhs[i] | rhs[i];
+}
+
+/* byte tags -> bits: bit i is set iff tags[i] != 0; n <= 64 */
+static inline uint64_t tag_bits_pack(uint8_t const *tags, size_t n) {
+  uint64_t bits = 0;
+  size_t i = 0;
+#ifdef __AVX2__
+  for (; i + 32 <= n; i += 32) {
+    tag_v32qi z = (tag_v32qi)(tag_v32_load(tags + i) == (tag_v32qi){0});
+    uint32_t m = __builtin_ia32_pmovmskb256(z);
+    bits |= (uint64_t)(uint32_t)~m << i;
+  }
+#endif
+  for (; i + 8 <= n; i += 8) {
+    uint64_t w;
+    memcpy(&w, tags + i, 8);
+    /* fold each byte into its lowest bit, then gather the 8 lowest bits */
+    w |= w >> 4;
+    w |= w >> 2;
+    w |= w >> 1;
+    w &= TAG_BYTES_LSB;
+    bits |= ((w * 0x0102040810204080ULL) >> 56) << i;
+  }
+  for (; i < n; i++)
+    bits |= (uint64_t)(tags[i] != 0) << i;
+  return bits;
+}
+
+/* bits -> byte tags: tags[i] = bit i of bits, for i in [0, n); n <= 64 */
+static inline void tag_bits_unpack(uint8_t *tags, uint64_t bits, size_t n) {
+  size_t i = 0;
+#ifdef __AVX2__
+  const tag_v32qi spread = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1,
+                            2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3};
+  const long long bit_j = (long long)0x8040201008040201ULL;
+  const tag_v32qi select = (tag_v32qi)(tag_v4di){bit_j, bit_j, bit_j, bit_j};
+  for (; i + 32 <= n; i += 32) {
+    /* byte j takes bit j % 8 of byte j / 8 of the 32 bits */
+    int x = (int)(uint32_t)(bits >> i);
+    tag_v32qi v = (tag_v32qi)(tag_v8si){x, x, x, x, x, x, x, x};
+    v = __builtin_ia32_pshufb256(v, spread) & select;
+    v = (tag_v32qi)(v == select) & 1;
+    memcpy(tags + i, &v, 32);
+  }
+#endif
+  for (; i + 8 <= n; i += 8) {
+    /* copy the byte to all 8 lanes, keep bit j in lane j, then carry any
+       set bit of a lane into its top bit and move it down to the bottom */
+    uint64_t b = (bits >> i) & 0xff;
+    uint64_t w = (b * TAG_BYTES_LSB) & 0x8040201008040201ULL;
+    w = ((w + 0x7f7f7f7f7f7f7f7fULL) >> 7) & TAG_BYTES_LSB;
+    memcpy(tags + i, &w, 8);
+  }
+  for (; i < n; i++)
+    tags[i] = (bits >> i) & 1;
+}
+
+static inline uint64_t tag_bits_mask(size_t n) {
+  return n >= 64 ? ~0ULL : (1ULL << n) - 1;
+}
+
+/* bits [off, off + n) of map; n <= 64, may straddle two words */
+static inline uint64_t tag_bits_load(uint64_t const *map, size_t off,
+                                     size_t n) {
+  size_t w = off >> 6, b = off & 63;
+  uint64_t v = map[w] >> b;
+  if (b + n > 64)
+    v |= map[w + 1] << (64 - b);
+  return v & tag_bits_mask(n);
+}
+
+/* bits [off, off + n) of map = bits, others untouched (masked blend) */
+static inline void tag_bits_store(uint64_t *map, size_t off, size_t n,
+                                  uint64_t bits) {
+  size_t w = off >> 6, b = off & 63;
+  uint64_t m = tag_bits_mask(n);
+  bits &= m;
+  map[w] = (map[w] & ~(m << b)) | (bits << b);
+  if (b + n > 64)
+    map[w + 1] = (map[w + 1] & ~(m >> (64 - b))) | (bits >> (64 - b));
+}
+
+/* set (bit = 1) or clear bits [off, off + n) of map */
+static inline void tag_bits_fill(uint64_t *map, size_t off, size_t n,
+                                 bool bit) {
+  while (n > 0) {
+    size_t b = off & 63;
+    size_t k = n < 64 - b ? n : 64 - b;
+    uint64_t m = tag_bits_mask(k) << b;
+    map[off >> 6] = bit ? map[off >> 6] | m : map[off >> 6] & ~m;
+    off += k;
+    n -= k;
+  }
+}
+
+/* true if any of bits [off, off + n) of map is set */
+static inline bool tag_bits_any(uint64_t const *map, size_t off, size_t n) {
+  while (n > 0 && (off & 63) != 0) {
+    size_t k = n < 64 - (off & 63) ? n : 64 - (off & 63);
+    if (tag_bits_load(map, off, k))
+      return true;
+    off += k;
+    n -= k;
+  }
+  uint64_t const *p = map + (off >> 6);
+#ifdef __AVX2__
+  for (; n >= 256; n -= 256, p += 4)
+    if (!tag_v32_zero(tag_v32_load(p)))
+      return true;
+#endif
+  for (; n >= 64; n -= 64, p++)
+    if (*p)
+      return true;
+  return n > 0 && (*p & tag_bits_mask(n)) != 0;
+}
+
+#endif /* __TAG_BITS_H__ */
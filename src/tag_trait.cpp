@@ -1,6 +1,9 @@
 #include "pin.H"
 #include "tag_traits.h"
 #include <string.h>
+#include <list>
+#include <queue>
+#include <vector>
 #include "sylvan.h"
 #include "ssa_tag.h"
 
@@ -24,6 +27,13 @@ uint8_t tag_combine(uint8_t const &lhs, uint8_t const &rhs,uint64_t tid)
   return lhs | rhs;
 }
 
+/* tags are 0 or 1 (see tag_alloc), so the union is 1 iff some tag is set */
+template <>
+uint8_t tag_combine_n<uint8_t>(uint8_t const *tags, size_t n, uint64_t tid)
+{
+  return !tag_bytes_clean(tags, n);
+}
+
 template <>
 std::string tag_sprint(uint8_t const &tag)
 {
@@ -37,6 +47,20 @@ uint8_t tag_alloc<uint8_t>(unsigned int offset,uint64_t tid)
 {
   return offset > 0;
 }
+
+template <>
+void tag_alloc_n<uint8_t>(uint8_t *tags, unsigned int offset, size_t n, uint64_t tid)
+{
+  memset(tags, 1, n);
+  if (offset == 0 && n > 0)
+    tags[0] = 0;
+}
+
+template <>
+uint8_t tag_alloc_range<uint8_t>(unsigned int begin, unsigned int end, uint64_t tid)
+{
+  return end > begin && end > 1;
+}
 const uint8_t tag_traits<uint8_t>::cleared_val = 0;
 
 /********************************************************
@@ -52,6 +76,25 @@ std::set<uint32_t> tag_alloc(uint32_t offset,uint64_t tid)
 	return res;
 }
 
+template <>
+void tag_alloc_n(std::set<uint32_t> *tags, unsigned int offset, size_t n, uint64_t tid)
+{
+	for (size_t i = 0; i < n; i++)
+	{
+		tags[i].clear();
+		tags[i].insert(offset + i);
+	}
+}
+
+template <>
+std::set<uint32_t> tag_alloc_range(unsigned int begin, unsigned int end, uint64_t tid)
+{
+	std::set<uint32_t> res;
+	for (uint32_t i = begin; i < end; i++)
+		res.insert(res.end(), i);
+	return res;
+}
+
 template <>
 std::set<uint32_t> tag_combine(std::set<uint32_t> const &lhs, std::set<uint32_t> const &rhs,uint64_t tid)
 {
@@ -65,6 +108,42 @@ std::set<uint32_t> tag_combine(std::set<uint32_t> const &lhs, std::set<uint32_t>
 	return res;
 }
 
+/* k-way merge: a min-heap of the current element of every input, each offset is inserted once, at the end */
+template <>
+std::set<uint32_t> tag_combine_n(std::set<uint32_t> const *tags, size_t n, uint64_t tid)
+{
+	typedef std::set<uint32_t>::const_iterator iter;
+	typedef std::pair<uint32_t, size_t> head;
+	std::priority_queue<head, std::vector<head>, std::greater<head>> heap;
+	std::vector<iter> cur(n);
+	size_t nonempty = 0, last = 0;
+	for (size_t i = 0; i < n; i++)
+	{
+		if (tags[i].empty())
+			continue;
+		cur[i] = tags[i].begin();
+		heap.push(head(*cur[i], i));
+		nonempty++;
+		last = i;
+	}
+	if (nonempty == 0)
+		return std::set<uint32_t>();
+	if (nonempty == 1)
+		return tags[last];
+
+	std::set<uint32_t> res;
+	while (!heap.empty())
+	{
+		head h = heap.top();
+		heap.pop();
+		if (res.empty() || *res.rbegin() != h.first)
+			res.insert(res.end(), h.first);
+		if (++cur[h.second] != tags[h.second].end())
+			heap.push(head(*cur[h.second], h.second));
+	}
+	return res;
+}
+
 template <>
 std::string tag_sprint(std::set<uint32_t> const &tag)
 {
@@ -100,6 +179,39 @@ EWAHBoolArray<uint32_t> tag_combine(EWAHBoolArray<uint32_t> const & lhs, EWAHBoo
 	return result;
 }
 
+/* always or the two smallest bitmaps, so the large ones are scanned as few times as possible */
+template<>
+EWAHBoolArray<uint32_t> tag_combine_n(EWAHBoolArray<uint32_t> const *tags, size_t n, uint64_t tid) {
+#ifdef TAINT_PROFILE
+	uint64_t pre = __rdtsc();
+#endif
+	typedef std::pair<size_t, EWAHBoolArray<uint32_t> *> item;
+	std::priority_queue<item, std::vector<item>, std::greater<item>> heap;
+	std::list<EWAHBoolArray<uint32_t>> tmp;
+	for (size_t i = 0; i < n; i++)
+		if (tags[i].sizeInBits() != 0)
+			heap.push(item(tags[i].sizeInBytes(), (EWAHBoolArray<uint32_t> *)&tags[i]));
+	EWAHBoolArray<uint32_t> result;
+	if (!heap.empty())
+	{
+		while (heap.size() > 1)
+		{
+			EWAHBoolArray<uint32_t> *a = heap.top().second;
+			heap.pop();
+			EWAHBoolArray<uint32_t> *b = heap.top().second;
+			heap.pop();
+			tmp.emplace_back();
+			a->logicalor(*b, tmp.back());
+			heap.push(item(tmp.back().sizeInBytes(), &tmp.back()));
+		}
+		result = *heap.top().second;
+	}
+#ifdef TAINT_PROFILE
+	combine_time+= __rdtsc()- pre;
+#endif
+	return result;
+}
+
 template<>
 EWAHBoolArray<uint32_t> tag_alloc(unsigned int offset,uint64_t tid)
 {
@@ -114,6 +226,37 @@ EWAHBoolArray<uint32_t> tag_alloc(unsigned int offset,uint64_t tid)
 	return t;
 }
 
+template<>
+void tag_alloc_n(EWAHBoolArray<uint32_t> *tags, unsigned int offset, size_t n, uint64_t tid)
+{
+#ifdef TAINT_PROFILE
+	uint64_t pre = __rdtsc();
+#endif
+	for (size_t i = 0; i < n; i++)
+	{
+		tags[i].reset();
+		tags[i].set(offset + i);
+	}
+#ifdef TAINT_PROFILE
+	alloc_time+= __rdtsc()- pre;
+#endif
+}
+
+template<>
+EWAHBoolArray<uint32_t> tag_alloc_range(unsigned int begin, unsigned int end, uint64_t tid)
+{
+#ifdef TAINT_PROFILE
+	uint64_t pre = __rdtsc();
+#endif
+	EWAHBoolArray<uint32_t> t;
+	for (uint32_t i = begin; i < end; i++)
+		t.set(i);
+#ifdef TAINT_PROFILE
+	alloc_time+= __rdtsc()- pre;
+#endif
+	return t;
+}
+
 template<>
 std::string tag_sprint(EWAHBoolArray<uint32_t> const & tag) {
     std::stringstream ss;
@@ -142,6 +285,21 @@ lb_type tag_combine(lb_type const &lhs, lb_type const &rhs,uint64_t tid)
 #endif
 }
 
+template <>
+lb_type tag_combine_n<lb_type>(lb_type const *tags, size_t n, uint64_t tid)
+{
+#ifdef TAINT_PROFILE
+	uint64_t pre =  __rdtsc();
+#endif
+	lb_type res = 0;
+	for (size_t i = 0; i < n; i++)
+		res = bdd_tag.combine(res, tags[i]);
+#ifdef TAINT_PROFILE
+	combine_time += __rdtsc()-pre;
+#endif
+	return res;
+}
+
 template <>
 std::string tag_sprint(lb_type const &tag)
 {
@@ -161,8 +319,168 @@ lb_type tag_alloc<lb_type>(unsigned int offset,uint64_t tid)
 #endif
 }
 
+template <>
+void tag_alloc_n<lb_type>(lb_type *tags, unsigned int offset, size_t n, uint64_t tid)
+{
+#ifdef TAINT_PROFILE
+	uint64_t pre =  __rdtsc();
+	bdd_tag.insert_n(offset, n, tags);
+	alloc_time += __rdtsc()-pre;
+#else
+  bdd_tag.insert_n(offset, n, tags);
+#endif
+}
+
+template <>
+lb_type tag_alloc_range<lb_type>(unsigned int begin, unsigned int end, uint64_t tid)
+{
+#ifdef TAINT_PROFILE
+	uint64_t pre =  __rdtsc();
+	lb_type res = bdd_tag.insert_range(begin, end);
+	alloc_time += __rdtsc()-pre;
+	return res;
+#else
+  return bdd_tag.insert_range(begin, end);
+#endif
+}
+
 std::vector<tag_seg> tag_get(lb_type t) { return bdd_tag.find(t); }
 
+/********************************************************
+interval tags
+********************************************************/
+const IntervalTag tag_traits<IntervalTag>::cleared_val = IntervalTag();
+
+template <>
+IntervalTag tag_combine(IntervalTag const &lhs, IntervalTag const &rhs, uint64_t tid)
+{
+#ifdef TAINT_PROFILE
+	uint64_t pre = __rdtsc();
+	IntervalTag res = IntervalTag::merge(lhs, rhs);
+	combine_time += __rdtsc() - pre;
+	return res;
+#else
+	return IntervalTag::merge(lhs, rhs);
+#endif
+}
+
+template <>
+IntervalTag tag_combine_n<IntervalTag>(IntervalTag const *tags, size_t n, uint64_t tid)
+{
+#ifdef TAINT_PROFILE
+	uint64_t pre = __rdtsc();
+	IntervalTag res = IntervalTag::merge_n(tags, n);
+	combine_time += __rdtsc() - pre;
+	return res;
+#else
+	return IntervalTag::merge_n(tags, n);
+#endif
+}
+
+template <>
+std::string tag_sprint(IntervalTag const &tag)
+{
+	return tag.to_string();
+}
+
+template <>
+IntervalTag tag_alloc<IntervalTag>(unsigned int offset, uint64_t tid)
+{
+	return IntervalTag(offset, offset + 1);
+}
+
+template <>
+void tag_alloc_n<IntervalTag>(IntervalTag *tags, unsigned int offset, size_t n, uint64_t tid)
+{
+	for (size_t i = 0; i < n; i++)
+	{
+		tags[i].clear();
+		tags[i].append(offset + i, offset + i + 1);
+	}
+}
+
+template <>
+IntervalTag tag_alloc_range<IntervalTag>(unsigned int begin, unsigned int end, uint64_t tid)
+{
+	return IntervalTag(begin, end);
+}
+
+/********************************************************
+roaring tags
+********************************************************/
+const RoaringTag tag_traits<RoaringTag>::cleared_val = RoaringTag();
+
+template <>
+RoaringTag tag_combine(RoaringTag const &lhs, RoaringTag const &rhs, uint64_t tid)
+{
+#ifdef TAINT_PROFILE
+	uint64_t pre = __rdtsc();
+	RoaringTag res = RoaringTag::merge(lhs, rhs);
+	combine_time += __rdtsc() - pre;
+	return res;
+#else
+	return RoaringTag::merge(lhs, rhs);
+#endif
+}
+
+template <>
+RoaringTag tag_combine_n<RoaringTag>(RoaringTag const *tags, size_t n, uint64_t tid)
+{
+#ifdef TAINT_PROFILE
+	uint64_t pre = __rdtsc();
+	RoaringTag res = RoaringTag::merge_n(tags, n);
+	combine_time += __rdtsc() - pre;
+	return res;
+#else
+	return RoaringTag::merge_n(tags, n);
+#endif
+}
+
+template <>
+std::string tag_sprint(RoaringTag const &tag)
+{
+	return tag.to_string();
+}
+
+template <>
+RoaringTag tag_alloc<RoaringTag>(unsigned int offset, uint64_t tid)
+{
+#ifdef TAINT_PROFILE
+	uint64_t pre = __rdtsc();
+	RoaringTag res = RoaringTag::single(offset);
+	alloc_time += __rdtsc() - pre;
+	return res;
+#else
+	return RoaringTag::single(offset);
+#endif
+}
+
+template <>
+void tag_alloc_n<RoaringTag>(RoaringTag *tags, unsigned int offset, size_t n, uint64_t tid)
+{
+#ifdef TAINT_PROFILE
+	uint64_t pre = __rdtsc();
+#endif
+	for (size_t i = 0; i < n; i++)
+		tags[i] = RoaringTag::single(offset + i);
+#ifdef TAINT_PROFILE
+	alloc_time += __rdtsc() - pre;
+#endif
+}
+
+template <>
+RoaringTag tag_alloc_range<RoaringTag>(unsigned int begin, unsigned int end, uint64_t tid)
+{
+#ifdef TAINT_PROFILE
+	uint64_t pre = __rdtsc();
+	RoaringTag res = RoaringTag::range(begin, end);
+	alloc_time += __rdtsc() - pre;
+	return res;
+#else
+	return RoaringTag::range(begin, end);
+#endif
+}
+
 /********************************************************
 ssa  tags
 ********************************************************/
@@ -190,6 +508,37 @@ alloc_count++;
 #endif
 }
 
+template <>
+void tag_alloc_n<ssa_tag>(ssa_tag *tags, unsigned int offset, size_t n, uint64_t tid)
+{
+#ifdef TAINT_PROFILE
+  uint64_t pre =  __rdtsc();
+  ssa_tag_alloc_n(tags, offset, n, tid);
+  alloc_time += __rdtsc() - pre;
+#else
+#ifdef TAINT_COUNT
+alloc_count += n;
+#endif
+  ssa_tag_alloc_n(tags, offset, n, tid);
+#endif
+}
+
+template <>
+ssa_tag tag_alloc_range<ssa_tag>(unsigned int begin, unsigned int end, uint64_t tid)
+{
+#ifdef TAINT_PROFILE
+  uint64_t pre =  __rdtsc();
+  ssa_tag res = ssa_tag_alloc_range(begin, end, tid);
+  alloc_time += __rdtsc() - pre;
+  return res;
+#else
+#ifdef TAINT_COUNT
+alloc_count++;
+#endif
+  return ssa_tag_alloc_range(begin, end, tid);
+#endif
+}
+
 template <>
 ssa_tag tag_combine(ssa_tag const &lhs, ssa_tag const &rhs,uint64_t tid)
 {
@@ -201,4 +550,29 @@ ssa_tag tag_combine(ssa_tag const &lhs, ssa_tag const &rhs,uint64_t tid)
 #else
   return ssa_tag_combine(lhs,rhs,tid);
 #endif
+}
+
+template <>
+ssa_tag tag_combine_n<ssa_tag>(ssa_tag const *tags, size_t n, uint64_t tid)
+{
+#ifdef TAINT_PROFILE
+  uint64_t pre =  __rdtsc();
+  ssa_tag res = ssa_tag_combine_n(tags, n, tid);
+  combine_time += __rdtsc() - pre;
+  return res;
+#else
+  return ssa_tag_combine_n(tags, n, tid);
+#endif
+}
+
+template <>
+void tag_combine_v<ssa_tag>(ssa_tag *dst, ssa_tag const *lhs, ssa_tag const *rhs, size_t n, uint64_t tid)
+{
+#ifdef TAINT_PROFILE
+  uint64_t pre =  __rdtsc();
+  ssa_tag_combine_v(dst, lhs, rhs, n, tid);
+  combine_time += __rdtsc() - pre;
+#else
+  ssa_tag_combine_v(dst, lhs, rhs, n, tid);
+#endif
 }
\ No newline at end of file
@@ -4,6 +4,7 @@
 #include <string>
 #include <set>
 #include "ewah.h"
+#include "tag_bits.h"
 template <typename T>
 struct tag_traits
 {
@@ -14,10 +15,39 @@ template <typename T>
 std::string tag_sprint(T const &tag);
 template <typename T>
 T tag_alloc(unsigned int offset,uint64_t tid);
+/* tags[i] = tag_alloc<T>(offset + i) for i in [0, n) */
+template <typename T>
+void tag_alloc_n(T *tags, unsigned int offset, size_t n, uint64_t tid);
+/* one tag holding every offset in [begin, end) */
+template <typename T>
+T tag_alloc_range(unsigned int begin, unsigned int end, uint64_t tid);
+/* the union of tags[0..n) in one request instead of n - 1 tag_combine() calls */
+template <typename T>
+T tag_combine_n(T const *tags, size_t n, uint64_t tid);
+/* dst[i] = tag_combine(lhs[i], rhs[i]) for the n byte lanes of one operation; dst may be lhs or rhs */
+template <typename T>
+inline void tag_combine_v(T *dst, T const *lhs, T const *rhs, size_t n, uint64_t tid)
+{
+  for (size_t i = 0; i < n; i++)
+    dst[i] = tag_combine(lhs[i], rhs[i], tid);
+}
 
 template <typename T>
 inline bool tag_is_empty(T const &tag);
 
+/*
+ * how a tag page of the tagmap stores its tags: by default a slot is the tag
+ * itself; a tag type may select a narrower slot. The tagmap converts only
+ * when a tag enters (store) or leaves (load) a page
+ */
+template <typename T>
+struct tag_page_traits
+{
+  typedef T slot_t;
+  static inline T load(slot_t const &slot) { return slot; }
+  static inline void store(slot_t &slot, T const &tag) { slot = tag; }
+};
+
 /********************************************************
  uint8_t tags
  ********************************************************/
@@ -36,6 +66,12 @@ template <>
 std::string tag_sprint(uint8_t const &tag);
 template <>
 uint8_t tag_alloc<uint8_t>(unsigned int offset,uint64_t tid);
+template <>
+void tag_alloc_n<uint8_t>(uint8_t *tags, unsigned int offset, size_t n, uint64_t tid);
+template <>
+uint8_t tag_alloc_range<uint8_t>(unsigned int begin, unsigned int end, uint64_t tid);
+template <>
+uint8_t tag_combine_n<uint8_t>(uint8_t const *tags, size_t n, uint64_t tid);
 
 template <>
 inline bool tag_is_empty(uint8_t const &tag)
@@ -43,6 +79,12 @@ inline bool tag_is_empty(uint8_t const &tag)
   return tag == 0;
 }
 
+template <>
+inline void tag_combine_v<uint8_t>(uint8_t *dst, uint8_t const *lhs, uint8_t const *rhs, size_t n, uint64_t tid)
+{
+  tag_bytes_or(dst, lhs, rhs, n);
+}
+
 /********************************************************
  uint32_t set tags
  ********************************************************/
@@ -57,9 +99,18 @@ struct tag_traits<std::set<uint32_t> >
 template<>
 std::set<uint32_t> tag_alloc(uint32_t offset,uint64_t tid);
 
+template<>
+void tag_alloc_n(std::set<uint32_t> *tags, unsigned int offset, size_t n, uint64_t tid);
+
+template<>
+std::set<uint32_t> tag_alloc_range(unsigned int begin, unsigned int end, uint64_t tid);
+
 template<>
 std::set<uint32_t> tag_combine(std::set<uint32_t> const & lhs, std::set<uint32_t> const & rhs,uint64_t tid);
 
+template<>
+std::set<uint32_t> tag_combine_n(std::set<uint32_t> const *tags, size_t n, uint64_t tid);
+
 template<>
 std::string tag_sprint(std::set<uint32_t> const & tag);
 
@@ -86,9 +137,18 @@ struct tag_traits<EWAHBoolArray<uint32_t>>
 template<>
 EWAHBoolArray<uint32_t> tag_combine(EWAHBoolArray<uint32_t> const & lhs, EWAHBoolArray<uint32_t> const & rhs,uint64_t tid);
 
+template<>
+EWAHBoolArray<uint32_t> tag_combine_n(EWAHBoolArray<uint32_t> const *tags, size_t n, uint64_t tid);
+
 template<>
 EWAHBoolArray<uint32_t> tag_alloc(unsigned int offset,uint64_t tid);
 
+template<>
+void tag_alloc_n(EWAHBoolArray<uint32_t> *tags, unsigned int offset, size_t n, uint64_t tid);
+
+template<>
+EWAHBoolArray<uint32_t> tag_alloc_range(unsigned int begin, unsigned int end, uint64_t tid);
+
 template<>
 std::string tag_sprint(EWAHBoolArray<uint32_t> const & tag);
 
@@ -119,6 +179,12 @@ template <>
 std::string tag_sprint(lb_type const &tag);
 template <>
 lb_type tag_alloc<lb_type>(unsigned int offset,uint64_t tid);
+template <>
+void tag_alloc_n<lb_type>(lb_type *tags, unsigned int offset, size_t n, uint64_t tid);
+template <>
+lb_type tag_alloc_range<lb_type>(unsigned int begin, unsigned int end, uint64_t tid);
+template <>
+lb_type tag_combine_n<lb_type>(lb_type const *tags, size_t n, uint64_t tid);
 
 std::vector<tag_seg> tag_get(lb_type);
 template <>
@@ -128,6 +194,70 @@ inline bool tag_is_empty(lb_type const &tag)
   return tag == 0;
 }
 
+/********************************************************
+interval tags
+********************************************************/
+#include "interval_tag.h"
+
+typedef IntervalTag libdft_interval_tag;
+
+template <>
+struct tag_traits<IntervalTag>
+{
+  static const IntervalTag cleared_val;
+};
+
+template <>
+IntervalTag tag_combine(IntervalTag const &lhs, IntervalTag const &rhs, uint64_t tid);
+template <>
+std::string tag_sprint(IntervalTag const &tag);
+template <>
+IntervalTag tag_alloc<IntervalTag>(unsigned int offset, uint64_t tid);
+template <>
+void tag_alloc_n<IntervalTag>(IntervalTag *tags, unsigned int offset, size_t n, uint64_t tid);
+template <>
+IntervalTag tag_alloc_range<IntervalTag>(unsigned int begin, unsigned int end, uint64_t tid);
+template <>
+IntervalTag tag_combine_n<IntervalTag>(IntervalTag const *tags, size_t n, uint64_t tid);
+
+template <>
+inline bool tag_is_empty(IntervalTag const &tag)
+{
+  return tag.empty();
+}
+
+/********************************************************
+roaring tags
+********************************************************/
+#include "roaring_tag.h"
+
+typedef RoaringTag libdft_roaring_tag;
+
+template <>
+struct tag_traits<RoaringTag>
+{
+  static const RoaringTag cleared_val;
+};
+
+template <>
+RoaringTag tag_combine(RoaringTag const &lhs, RoaringTag const &rhs, uint64_t tid);
+template <>
+std::string tag_sprint(RoaringTag const &tag);
+template <>
+RoaringTag tag_alloc<RoaringTag>(unsigned int offset, uint64_t tid);
+template <>
+void tag_alloc_n<RoaringTag>(RoaringTag *tags, unsigned int offset, size_t n, uint64_t tid);
+template <>
+RoaringTag tag_alloc_range<RoaringTag>(unsigned int begin, unsigned int end, uint64_t tid);
+template <>
+RoaringTag tag_combine_n<RoaringTag>(RoaringTag const *tags, size_t n, uint64_t tid);
+
+template <>
+inline bool tag_is_empty(RoaringTag const &tag)
+{
+  return tag.empty();
+}
+
 /********************************************************
 ssa  tags
 ********************************************************/
@@ -147,12 +277,31 @@ template <>
 std::string tag_sprint(ssa_tag const &tag);
 template <>
 ssa_tag tag_alloc<ssa_tag>(unsigned int offset,uint64_t tid);
+template <>
+void tag_alloc_n<ssa_tag>(ssa_tag *tags, unsigned int offset, size_t n, uint64_t tid);
+template <>
+ssa_tag tag_alloc_range<ssa_tag>(unsigned int begin, unsigned int end, uint64_t tid);
+template <>
+ssa_tag tag_combine_n<ssa_tag>(ssa_tag const *tags, size_t n, uint64_t tid);
+template <>
+void tag_combine_v<ssa_tag>(ssa_tag *dst, ssa_tag const *lhs, ssa_tag const *rhs, size_t n, uint64_t tid);
 
 inline bool tag_is_empty(ssa_tag const &tag)
 {
   return tag == tag_traits<ssa_tag>::cleared_val;
 }
 
+#if !defined(SSA_NOGC) && SSA_PAGE_PACKED
+/* 32-bit slots: an inline set or the index of the ssa (see ssa_tag_gc.h) */
+template <>
+struct tag_page_traits<ssa_tag>
+{
+  typedef uint32_t slot_t;
+  static inline ssa_tag load(slot_t const &slot) { return ssa_slot_load(slot); }
+  static inline void store(slot_t &slot, ssa_tag const &tag) { ssa_slot_store(slot, tag); }
+};
+#endif
+
 /********************************************************
 setting
 ********************************************************/
@@ -164,8 +313,13 @@ typedef libdft_bdd_tag tag_t;
 typedef libdft_ewah_tag tag_t;
 #elif defined(TAG_UINT8)
 typedef libdft_tag_uint8 tag_t;
+#define TAG_BOOL /* tags are 0 or 1: tag pages keep one bit per byte (tagmap.h) */
 #elif defined(TAG_SET)
 typedef libdft_set_tag tag_t;
+#elif defined(TAG_INTERVAL)
+typedef libdft_interval_tag tag_t;
+#elif defined(TAG_ROARING)
+typedef libdft_roaring_tag tag_t;
 #endif
 
 #endif /* LIBDFT_TAG_TRAITS_H */
\ No newline at end of file
@@ -42,82 +42,277 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <unistd.h>
+#include <vector>
 
 tag_dir_t tag_dir;
 extern thread_ctx_t *threads_ctx;
 
-inline void tag_dir_setb(tag_dir_t &dir, ADDRINT addr, tag_t const &tag) {
+/*
+ * map the top-level directory and the taint map; MAP_NORESERVE keeps them
+ * out of the RSS until they are actually written
+ */
+static void *tag_dir_map(void **ptr, size_t size) {
+  void *p = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (p == MAP_FAILED) {
+    LOG("Failed to allocate tag directory!\n");
+    libdft_die();
+  }
+  if (!__sync_bool_compare_and_swap(ptr, NULL, p))
+    munmap(p, size);
+  return *ptr;
+}
+
+static tag_table_t **tag_dir_table_alloc(tag_dir_t &dir) {
+  if (dir.taint_map == NULL)
+    tag_dir_map((void **)&dir.taint_map, sizeof(uint64_t) * TAINT_MAP_SZ);
+  return (tag_table_t **)tag_dir_map((void **)&dir.table,
+                                     sizeof(tag_table_t *) * TOP_DIR_SZ);
+}
+
+inline void taint_map_set(tag_dir_t &dir, ADDRINT addr) {
+  uint64_t pg = addr >> PAGE_BITS;
+  uint64_t bit = 1UL << (pg & 63);
+  if (!(dir.taint_map[pg >> 6] & bit))
+    __sync_fetch_and_or(&dir.taint_map[pg >> 6], bit);
+}
+
+inline void taint_map_clear(tag_dir_t &dir, ADDRINT addr) {
+  uint64_t pg = addr >> PAGE_BITS;
+  __sync_fetch_and_and(&dir.taint_map[pg >> 6], ~(1UL << (pg & 63)));
+}
+
+/*
+ * return the table slot of the page of addr; the directory and the table
+ * are allocated on demand only if alloc is set, otherwise NULL is returned
+ * when they do not exist. A lookup with alloc is made before a page is
+ * installed, so it also marks the page in the taint map
+ */
+inline tag_page_t **tag_dir_slot(tag_dir_t &dir, ADDRINT addr, bool alloc) {
   if (addr > 0x7fffffffffff) {
-    return;
+    return NULL;
   }
-  // LOG("Setting tag "+hexstr(addr)+"\n");
-  if (dir.table[VIRT2PAGETABLE(addr)] == NULL) {
+  tag_table_t **top = dir.table;
+  if (unlikely(top == NULL)) {
+    if (!alloc)
+      return NULL;
+    top = tag_dir_table_alloc(dir);
+  }
+  if (top[VIRT2PAGETABLE(addr)] == NULL) {
+    if (!alloc)
+      return NULL;
     //  LOG("No tag table for "+hexstr(addr)+" allocating new table\n");
     tag_table_t *new_table = new (std::nothrow) tag_table_t();
     if (new_table == NULL) {
       LOG("Failed to allocate tag table!\n");
       libdft_die();
     }
-    dir.table[VIRT2PAGETABLE(addr)] = new_table;
+    /* another thread may have installed a table, and pages in it, first */
+    if (!__sync_bool_compare_and_swap(&top[VIRT2PAGETABLE(addr)], NULL,
+                                      new_table))
+      delete new_table;
   }
+  if (alloc)
+    taint_map_set(dir, addr);
+  return &(*top[VIRT2PAGETABLE(addr)]).page[VIRT2PAGE(addr)];
+}
 
-  tag_table_t *table = dir.table[VIRT2PAGETABLE(addr)];
-  if ((*table).page[VIRT2PAGE(addr)] == NULL) {
-    //    LOG("No tag page for "+hexstr(addr)+" allocating new page\n");
-    tag_page_t *new_page = new (std::nothrow) tag_page_t();
+/*
+ * the tags [off, off + n) of a private page; with TAG_BOOL the page is a
+ * bitmap and the tags are converted with the mask kernels of tag_bits.h
+ */
+#ifdef TAG_BOOL
+inline tag_t tag_page_get(tag_page_t const *page, size_t off) {
+  return (page->bits[off >> 6] >> (off & 63)) & 1;
+}
+
+inline void tag_page_fill(tag_page_t *page, size_t off, size_t n,
+                          tag_t const &tag) {
+  tag_bits_fill(page->bits, off, n, !tag_is_empty(tag));
+}
+
+inline void tag_page_read(tag_page_t const *page, size_t off, size_t n,
+                          tag_t *tags) {
+  for (size_t i = 0; i < n; i += 64) {
+    size_t k = std::min(n - i, (size_t)64);
+    tag_bits_unpack(tags + i, tag_bits_load(page->bits, off + i, k), k);
+  }
+}
+
+inline void tag_page_write(tag_page_t *page, size_t off, size_t n,
+                           tag_t const *tags) {
+  for (size_t i = 0; i < n; i += 64) {
+    size_t k = std::min(n - i, (size_t)64);
+    tag_bits_store(page->bits, off + i, k, tag_bits_pack(tags + i, k));
+  }
+}
+#else
+inline tag_t tag_page_get(tag_page_t const *page, size_t off) {
+  return tag_slot_load(page->tag[off]);
+}
+
+inline void tag_page_fill(tag_page_t *page, size_t off, size_t n,
+                          tag_t const &tag) {
+  for (size_t i = 0; i < n; i++)
+    tag_slot_store(page->tag[off + i], tag);
+}
+
+inline void tag_page_read(tag_page_t const *page, size_t off, size_t n,
+                          tag_t *tags) {
+  for (size_t i = 0; i < n; i++)
+    tags[i] = tag_slot_load(page->tag[off + i]);
+}
+
+inline void tag_page_write(tag_page_t *page, size_t off, size_t n,
+                           tag_t const *tags) {
+  for (size_t i = 0; i < n; i++)
+    tag_slot_store(page->tag[off + i], tags[i]);
+}
+#endif
+
+/* pool of cleared pages, shared by all threads */
+static tag_page_t *page_pool[TAG_PAGE_POOL_SZ];
+static size_t page_pool_n;
+static volatile int page_pool_lock;
+
+inline tag_page_t *tag_page_new(tag_t const &tag) {
+  tag_page_t *new_page = NULL;
+  while (__sync_lock_test_and_set(&page_pool_lock, 1))
+    ;
+  if (page_pool_n > 0)
+    new_page = page_pool[--page_pool_n];
+  __sync_lock_release(&page_pool_lock);
+
+  if (new_page == NULL) {
+    new_page = new (std::nothrow) tag_page_t();
     if (new_page == NULL) {
       LOG("Failed to allocate tag page!\n");
       libdft_die();
     }
-    std::fill(new_page->tag, new_page->tag + PAGE_SIZE,
-              tag_traits<tag_t>::cleared_val);
-    (*table).page[VIRT2PAGE(addr)] = new_page;
+  } else if (tag_is_empty(tag)) {
+    return new_page;
   }
+  tag_page_fill(new_page, 0, PAGE_SIZE, tag);
+  return new_page;
+}
 
-  tag_page_t *page = (*table).page[VIRT2PAGE(addr)];
-  (*page).tag[VIRT2OFFSET(addr)] = tag;
-  /*
-  if (!tag_is_empty(tag)) {
-    LOGD("[!]Writing tag for %p \n", (void *)addr);
+/*
+ * clear a page, releasing the references held by its tags, and keep it in
+ * the pool if there is room
+ */
+inline void tag_page_free(tag_page_t *page) {
+  tag_page_fill(page, 0, PAGE_SIZE, tag_traits<tag_t>::cleared_val);
+  while (__sync_lock_test_and_set(&page_pool_lock, 1))
+    ;
+  if (page_pool_n < TAG_PAGE_POOL_SZ) {
+    page_pool[page_pool_n++] = page;
+    page = NULL;
   }
-  */
+  __sync_lock_release(&page_pool_lock);
+  if (page != NULL)
+    delete page;
 }
 
-inline void tag_dir_setb_save_mem(tag_dir_t &dir, ADDRINT addr, tag_t const &tag) {
-  if (addr > 0x7fffffffffff) {
+/*
+ * pages unlinked from a table slot. A reader may still hold a page it
+ * loaded from the slot, so retired pages are only freed once every
+ * application thread has been stopped at a safe point, i.e. outside of any
+ * analysis routine, after they were unlinked
+ */
+static std::vector<tag_page_t *> page_retired;
+static volatile int page_retired_lock;
+static volatile int page_reclaiming;
+
+/*
+ * free the retired pages; called by the thread that fills up the retire
+ * list. If the application threads cannot be stopped right now the pages
+ * are kept for the next attempt
+ */
+static void tag_page_reclaim(void) {
+  if (!__sync_bool_compare_and_swap(&page_reclaiming, 0, 1))
     return;
+  std::vector<tag_page_t *> pages;
+  THREADID tid = PIN_ThreadId();
+  if (PIN_StopApplicationThreads(tid)) {
+    while (__sync_lock_test_and_set(&page_retired_lock, 1))
+      ;
+    pages.swap(page_retired);
+    __sync_lock_release(&page_retired_lock);
+    PIN_ResumeApplicationThreads(tid);
   }
-  // LOG("Setting tag "+hexstr(addr)+"\n");
-  if (dir.table[VIRT2PAGETABLE(addr)] == NULL) {
-    if(tag_is_empty(tag))
-      return;
-    //  LOG("No tag table for "+hexstr(addr)+" allocating new table\n");
-    tag_table_t *new_table = new (std::nothrow) tag_table_t();
-    if (new_table == NULL) {
-      LOG("Failed to allocate tag table!\n");
-      libdft_die();
-    }
-    dir.table[VIRT2PAGETABLE(addr)] = new_table;
+  page_reclaiming = 0;
+  for (size_t i = 0; i < pages.size(); i++) {
+    if (PAGE_IS_UNIFORM(pages[i]))
+      delete PAGE2UNIFORM(pages[i]);
+    else
+      tag_page_free(pages[i]);
   }
+}
+
+static void tag_page_retire(tag_page_t *page) {
+  while (__sync_lock_test_and_set(&page_retired_lock, 1))
+    ;
+  page_retired.push_back(page);
+  size_t n = page_retired.size();
+  __sync_lock_release(&page_retired_lock);
+  if (n >= TAG_RETIRE_MAX)
+    tag_page_reclaim();
+}
+
+/*
+ * drop a reference to a page that was unlinked from a table slot: private
+ * pages have a single owner, uniform pages are retired with their last
+ * reference
+ */
+inline void tag_page_unref(tag_page_t *page) {
+  if (page == NULL)
+    return;
+  if (PAGE_IS_UNIFORM(page) &&
+      __sync_sub_and_fetch(&PAGE2UNIFORM(page)->refs, 1) != 0)
+    return;
+  tag_page_retire(page);
+}
 
-  tag_table_t *table = dir.table[VIRT2PAGETABLE(addr)];
-  if ((*table).page[VIRT2PAGE(addr)] == NULL) {
+/* drop the page installed in a table slot */
+inline void tag_page_release(tag_page_t **slot) {
+  tag_page_unref(__sync_lock_test_and_set(slot, (tag_page_t *)NULL));
+}
+
+/*
+ * return a private page for a table slot: allocate a cleared one if the
+ * slot is empty, or split a uniform page (copy-on-write). The new page is
+ * installed with a CAS, so when two threads race only the winner drops the
+ * reference to the uniform page and the loser uses the winner's page
+ */
+inline tag_page_t *tag_page_private(tag_page_t **slot) {
+  while (true) {
+    tag_page_t *page = *(tag_page_t *volatile *)slot;
+    if (page != NULL && likely(!PAGE_IS_UNIFORM(page)))
+      return page;
     //    LOG("No tag page for "+hexstr(addr)+" allocating new page\n");
-    if(tag_is_empty(tag))
-      return;
-    tag_page_t *new_page = new (std::nothrow) tag_page_t();
-    if (new_page == NULL) {
-      LOG("Failed to allocate tag page!\n");
-      libdft_die();
+    tag_page_t *new_page =
+        tag_page_new(page == NULL ? tag_traits<tag_t>::cleared_val
+                                  : PAGE2UNIFORM(page)->tag);
+    if (__sync_bool_compare_and_swap(slot, page, new_page)) {
+      tag_page_unref(page);
+      return new_page;
     }
-    std::fill(new_page->tag, new_page->tag + PAGE_SIZE,
-              tag_traits<tag_t>::cleared_val);
-    (*table).page[VIRT2PAGE(addr)] = new_page;
+    tag_page_free(new_page);
   }
+}
 
-  tag_page_t *page = (*table).page[VIRT2PAGE(addr)];
-  (*page).tag[VIRT2OFFSET(addr)] = tag;
+inline void tag_dir_setb(tag_dir_t &dir, ADDRINT addr, tag_t const &tag) {
+  tag_page_t **slot = tag_dir_slot(dir, addr, true);
+  if (slot == NULL) {
+    return;
+  }
+  // LOG("Setting tag "+hexstr(addr)+"\n");
+  if (PAGE_IS_UNIFORM(*slot) && PAGE2UNIFORM(*slot)->tag == tag)
+    return;
+  tag_page_t *page = tag_page_private(slot);
+  tag_page_fill(page, VIRT2OFFSET(addr), 1, tag);
   /*
   if (!tag_is_empty(tag)) {
     LOGD("[!]Writing tag for %p \n", (void *)addr);
@@ -125,19 +320,53 @@ inline void tag_dir_setb_save_mem(tag_dir_t &dir, ADDRINT addr, tag_t const &tag
   */
 }
 
-inline tag_t const *tag_dir_getb_as_ptr(tag_dir_t const &dir, ADDRINT addr) {
-  if (addr > 0x7fffffffffff) {
+inline void tag_dir_setb_save_mem(tag_dir_t &dir, ADDRINT addr, tag_t const &tag) {
+  // LOG("Setting tag "+hexstr(addr)+"\n");
+  bool empty = tag_is_empty(tag);
+  tag_page_t **slot = tag_dir_slot(dir, addr, !empty);
+  if (slot == NULL)
+    return;
+  if (*slot == NULL) {
+    if (empty)
+      return;
+  } else if (PAGE_IS_UNIFORM(*slot) && PAGE2UNIFORM(*slot)->tag == tag) {
+    return;
+  }
+  tag_page_t *page = tag_page_private(slot);
+  tag_page_fill(page, VIRT2OFFSET(addr), 1, tag);
+  /*
+  if (!tag_is_empty(tag)) {
+    LOGD("[!]Writing tag for %p \n", (void *)addr);
+  }
+  */
+}
+
+/*
+ * return the private tag page of addr, allocating the table and the page on
+ * demand; NULL for addresses outside of the user address space
+ */
+inline tag_page_t *tag_dir_page_alloc(tag_dir_t &dir, ADDRINT addr) {
+  tag_page_t **slot = tag_dir_slot(dir, addr, true);
+  if (slot == NULL) {
     return NULL;
   }
+  return tag_page_private(slot);
+}
+
+inline tag_t tag_dir_getb(tag_dir_t const &dir, ADDRINT addr) {
+  if (addr > 0x7fffffffffff || dir.table == NULL) {
+    return tag_traits<tag_t>::cleared_val;
+  }
   if (dir.table[VIRT2PAGETABLE(addr)]) {
     tag_table_t *table = dir.table[VIRT2PAGETABLE(addr)];
     if ((*table).page[VIRT2PAGE(addr)]) {
       tag_page_t *page = (*table).page[VIRT2PAGE(addr)];
-      if (page != NULL)
-        return &(*page).tag[VIRT2OFFSET(addr)];
+      if (unlikely(PAGE_IS_UNIFORM(page)))
+        return PAGE2UNIFORM(page)->tag;
+      return tag_page_get(page, VIRT2OFFSET(addr));
     }
   }
-  return &tag_traits<tag_t>::cleared_val;
+  return tag_traits<tag_t>::cleared_val;
 }
 
 // PIN_FAST_ANALYSIS_CALL
@@ -167,7 +396,174 @@ void tagmap_setb_reg(THREADID tid, unsigned int reg_idx, unsigned int off,
   threads_ctx[tid].vcpu.gpr[reg_idx][off] = tag;
 }
 
-tag_t tagmap_getb(ADDRINT addr) { return *tag_dir_getb_as_ptr(tag_dir, addr); }
+/*
+ * set the tag of [addr, addr + n) to tag; every whole page in the range
+ * shares one uniform page, or is dropped when tag is empty. Tables are
+ * kept even when all of their pages are dropped, since other threads may
+ * be using them without synchronization. Only the partial pages at both
+ * ends are written byte by byte
+ */
+void tagmap_setn(ADDRINT addr, size_t n, tag_t const &tag) {
+#ifdef TAINT_VERIFY
+  if (!tag_is_empty(tag)) {
+    string s = tag_sprint(tag);
+    for (size_t i = 0; i < n; i++) {
+      write(fifo_fd, s.c_str(), s.length());
+      write(fifo_fd, "\n", 1);
+    }
+  }
+#endif
+  bool empty = tag_is_empty(tag);
+  tag_uniform_t *u = NULL;
+  while (n > 0 && addr <= 0x7fffffffffff) {
+    size_t chunk = PAGE_SIZE - VIRT2OFFSET(addr);
+    if (chunk > n)
+      chunk = n;
+    tag_page_t **slot = tag_dir_slot(tag_dir, addr, !empty);
+    if (slot == NULL) {
+      /* nothing to clear up to the end of this table */
+      if (tag_dir.table == NULL)
+        break;
+      chunk = PAGETABLE_SPAN - (addr & (PAGETABLE_SPAN - 1));
+      if (chunk > n)
+        chunk = n;
+    } else if (empty && *slot == NULL) {
+      /* already clean */
+    } else if (chunk < PAGE_SIZE) {
+      if (!PAGE_IS_UNIFORM(*slot) || !(PAGE2UNIFORM(*slot)->tag == tag))
+        tag_page_fill(tag_page_private(slot), VIRT2OFFSET(addr), chunk, tag);
+    } else {
+      if (empty) {
+        tag_page_release(slot);
+        taint_map_clear(tag_dir, addr);
+      } else {
+        if (u == NULL) {
+          u = new (std::nothrow) tag_uniform_t();
+          if (u == NULL) {
+            LOG("Failed to allocate tag page!\n");
+            libdft_die();
+          }
+          u->tag = tag;
+          /* our own reference keeps u alive while it is being installed */
+          u->refs = 1;
+        }
+        __sync_fetch_and_add(&u->refs, 1);
+        tag_page_unref(__sync_lock_test_and_set(slot, UNIFORM2PAGE(u)));
+      }
+    }
+    addr += chunk;
+    n -= chunk;
+  }
+  if (u != NULL)
+    tag_page_unref(UNIFORM2PAGE(u));
+}
+
+/*
+ * taint [addr, addr + n) with the tags of the input offsets
+ * [offset, offset + n); equivalent to calling tagmap_setb() with
+ * tag_alloc<tag_t>(offset + i) for every byte, but the tags are allocated
+ * TAGMAP_SETN_CHUNK at a time with one tag_alloc_n() request and the page
+ * is looked up once per chunk
+ */
+void tagmap_setn_offsets(ADDRINT addr, size_t n, unsigned int offset,
+                         THREADID tid) {
+  tag_t tags[TAGMAP_SETN_CHUNK];
+  while (n > 0) {
+    size_t chunk = PAGE_SIZE - VIRT2OFFSET(addr);
+    if (chunk > n)
+      chunk = n;
+    if (chunk > TAGMAP_SETN_CHUNK)
+      chunk = TAGMAP_SETN_CHUNK;
+    tag_page_t *page = tag_dir_page_alloc(tag_dir, addr);
+    if (unlikely(page == NULL))
+      return;
+    tag_alloc_n<tag_t>(tags, offset, chunk, tid);
+    tag_page_write(page, VIRT2OFFSET(addr), chunk, tags);
+#ifdef TAINT_VERIFY
+    for (size_t i = 0; i < chunk; i++) {
+      if (!tag_is_empty(tags[i])) {
+        string s = tag_sprint(tags[i]);
+        write(fifo_fd, s.c_str(), s.length());
+        write(fifo_fd, "\n", 1);
+      }
+    }
+#endif
+    addr += chunk;
+    offset += chunk;
+    n -= chunk;
+  }
+}
+
+/*
+ * coarse variant of tagmap_setn_offsets(): every byte of [addr, addr + n)
+ * gets the same tag, holding all of the input offsets [offset, offset + n);
+ * one tag_alloc_range() request, and whole pages become uniform pages
+ */
+void tagmap_setn_range(ADDRINT addr, size_t n, unsigned int offset,
+                       THREADID tid) {
+  if (unlikely(n == 0))
+    return;
+  tag_t tag = tag_alloc_range<tag_t>(offset, offset + n, tid);
+  tagmap_setn(addr, n, tag);
+}
+
+tag_t tagmap_getb(ADDRINT addr) { return tag_dir_getb(tag_dir, addr); }
+
+/*
+ * copy the tags of [addr, addr + n) to tags; the page is resolved once
+ * unless the access crosses a page boundary
+ */
+void tagmap_getw(ADDRINT addr, size_t n, tag_t *tags) {
+  if (unlikely(VIRT2OFFSET(addr) + n > PAGE_SIZE)) {
+    for (size_t i = 0; i < n; i++)
+      tags[i] = tag_dir_getb(tag_dir, addr + i);
+    return;
+  }
+  tag_page_t **slot = tag_dir_slot(tag_dir, addr, false);
+  if (slot == NULL || *slot == NULL) {
+    std::fill(tags, tags + n, tag_traits<tag_t>::cleared_val);
+  } else if (unlikely(PAGE_IS_UNIFORM(*slot))) {
+    std::fill(tags, tags + n, PAGE2UNIFORM(*slot)->tag);
+  } else {
+    tag_page_read(*slot, VIRT2OFFSET(addr), n, tags);
+  }
+}
+
+/*
+ * set the tags of [addr, addr + n) from tags; same semantics as n calls
+ * to tagmap_setb(), with one page lookup unless the access crosses a page
+ * boundary
+ */
+void tagmap_setw(ADDRINT addr, size_t n, tag_t const *tags) {
+  if (unlikely(VIRT2OFFSET(addr) + n > PAGE_SIZE)) {
+    for (size_t i = 0; i < n; i++)
+      tagmap_setb(addr + i, tags[i]);
+    return;
+  }
+  bool empty = true;
+  for (size_t i = 0; i < n; i++) {
+    if (!tag_is_empty(tags[i])) {
+      empty = false;
+#ifdef TAINT_VERIFY
+      string s = tag_sprint(tags[i]);
+      write(fifo_fd, s.c_str(), s.length());
+      write(fifo_fd, "\n", 1);
+#endif
+    }
+  }
+  tag_page_t **slot = tag_dir_slot(tag_dir, addr, !empty);
+  if (slot == NULL || (empty && *slot == NULL))
+    return;
+  if (unlikely(PAGE_IS_UNIFORM(*slot))) {
+    tag_t const &utag = PAGE2UNIFORM(*slot)->tag;
+    size_t i = 0;
+    while (i < n && tags[i] == utag)
+      i++;
+    if (i == n)
+      return;
+  }
+  tag_page_write(tag_page_private(slot), VIRT2OFFSET(addr), n, tags);
+}
 
 tag_t tagmap_getb_reg(THREADID tid, unsigned int reg_idx, unsigned int off) {
   return threads_ctx[tid].vcpu.gpr[reg_idx][off];
@@ -178,34 +574,58 @@ void PIN_FAST_ANALYSIS_CALL tagmap_clrb(ADDRINT addr) {
 }
 
 void PIN_FAST_ANALYSIS_CALL tagmap_clrn(ADDRINT addr, UINT32 n) {
-  ADDRINT i;
-  for (i = addr; i < addr + n; i++) {
-    tagmap_clrb(i);
-  }
+  tagmap_setn(addr, n, tag_traits<tag_t>::cleared_val);
 }
 
-tag_t tagmap_getn(ADDRINT addr, unsigned int n) {
+#ifdef TAG_BOOL
+/*
+ * union of the boolean tags of [addr, addr + n): set iff some byte is
+ * tainted, tested on the page bitmaps without converting the tags
+ */
+tag_t tagmap_getn(ADDRINT addr, unsigned int n, THREADID tid) {
+  while (n > 0) {
+    size_t chunk = PAGE_SIZE - VIRT2OFFSET(addr);
+    if (chunk > n)
+      chunk = n;
+    if (!tagmap_range_clean(addr, chunk)) {
+      tag_page_t **slot = tag_dir_slot(tag_dir, addr, false);
+      if (slot != NULL && *slot != NULL) {
+        if (PAGE_IS_UNIFORM(*slot)) {
+          if (!tag_is_empty(PAGE2UNIFORM(*slot)->tag))
+            return PAGE2UNIFORM(*slot)->tag;
+        } else if (tag_bits_any((*slot)->bits, VIRT2OFFSET(addr), chunk)) {
+          return 1;
+        }
+      }
+    }
+    addr += chunk;
+    n -= chunk;
+  }
+  return tag_traits<tag_t>::cleared_val;
+}
+#else
+/*
+ * union of the tags of [addr, addr + n): the tags are copied a chunk at a time
+ * and each chunk, together with the union so far, is merged by a single
+ * tag_combine_n() request
+ */
+tag_t tagmap_getn(ADDRINT addr, unsigned int n, THREADID tid) {
   tag_t ts = tag_traits<tag_t>::cleared_val;
-  for (size_t i = 0; i < n; i++) {
-    const tag_t t = tagmap_getb(addr + i);
-    if (tag_is_empty(t))
-      continue;
-    // LOGD("[tagmap_getn] %lu, ts: %d, %s\n", i, ts, tag_sprint(t).c_str());
-    ts = tag_combine(ts, t,0);//useless,just make compiler happy
-    // LOGD("t: %d, ts:%d\n", t, ts);
+  tag_t buf[TAGMAP_GETN_CHUNK];
+  size_t i = 0;
+  while (i < n) {
+    size_t k = 0;
+    if (!tag_is_empty(ts))
+      buf[k++] = ts;
+    size_t chunk = std::min((size_t)(n - i), TAGMAP_GETN_CHUNK - k);
+    tagmap_getw(addr + i, chunk, &buf[k]);
+    ts = tag_combine_n(buf, k + chunk, tid);
+    i += chunk;
   }
   return ts;
 }
+#endif
 
 tag_t tagmap_getn_reg(THREADID tid, unsigned int reg_idx, unsigned int n) {
-  tag_t ts = tag_traits<tag_t>::cleared_val;
-  for (size_t i = 0; i < n; i++) {
-    const tag_t t = tagmap_getb_reg(tid, reg_idx, i);
-    if (tag_is_empty(t))
-      continue;
-    // LOGD("[tagmap_getn] %lu, ts: %d, %s\n", i, ts, tag_sprint(t).c_str());
-    ts = tag_combine(ts, t,0);//useless,just make compiler happy
-    // LOGD("t: %d, ts:%d\n", t, ts);
-  }
-  return ts;
+  return tag_combine_n(threads_ctx[tid].vcpu.gpr[reg_idx], n, tid);
 }
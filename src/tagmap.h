@@ -34,6 +34,7 @@
 #define __TAGMAP_H__
 
 #include "pin.H"
+#include "branch_pred.h"
 #include "tag_traits.h"
 #include <utility>
 
@@ -45,6 +46,13 @@
 #define TOP_DIR_SZ 0x800000
 #define PAGETABLE_SZ 0X1000
 #define PAGETABLE_BITS 24
+#define PAGETABLE_SPAN (1UL << PAGETABLE_BITS) /* bytes covered by a table */
+#define TAG_PAGE_POOL_SZ 64 /* cleared pages kept for reuse */
+#define TAG_RETIRE_MAX 4096 /* unlinked pages freed in one batch */
+#define TAGMAP_GETN_CHUNK 32 /* operands per tag_combine_n() in tagmap_getn() */
+#define TAGMAP_SETN_CHUNK 512 /* tags per tag_alloc_n() in tagmap_setn_offsets() */
+#define USER_ADDR_MAX 0x7fffffffffffUL
+#define TAINT_MAP_SZ (((USER_ADDR_MAX + 1) >> PAGE_BITS) / 64) /* in words */
 #define OFFSET_MASK 0x00000FFFU
 #define PAGETABLE_OFFSET_MASK 0x00FFFFFFU
 
@@ -65,22 +73,93 @@ extern void libdft_die();
 // typedef std::array<tag_page_t*, PAGETABLE_SZ> tag_table_t;
 // typedef std::array<tag_table_t*, TOP_DIR_SZ> tag_dir_t;
 /* For file taint */
+/*
+ * a page holds tag_slot_t slots, which may be narrower than tag_t (see
+ * tag_page_traits), or a bitmap for boolean tags; tagmap.cpp accesses it
+ * only through the tag_page_get/fill/read/write() primitives
+ */
+typedef tag_page_traits<tag_t>::slot_t tag_slot_t;
+#ifdef TAG_BOOL
+/* boolean tags: bit (off & 63) of bits[off >> 6] is the tag of byte off */
 typedef struct {
-  tag_t tag[PAGE_SIZE];
+  uint64_t bits[PAGE_SIZE / 64];
 } tag_page_t;
+#else
+typedef struct {
+  tag_slot_t tag[PAGE_SIZE];
+} tag_page_t;
+#endif
 typedef struct {
   tag_page_t *page[PAGETABLE_SZ];
 } tag_table_t;
+/*
+ * the top-level directory is mapped on the first write of a non-empty tag;
+ * until then table is NULL and every address reads as cleared.
+ * taint_map has one bit per page, set when a tag page is installed for it
+ * and cleared when the page is dropped, so a clear bit means the page
+ * holds no taint; it is mapped before table
+ */
 typedef struct {
-  tag_table_t *table[TOP_DIR_SZ];
+  tag_table_t **table;
+  uint64_t *taint_map;
 } tag_dir_t;
 
+/*
+ * a uniform page stands for a page whose PAGE_SIZE bytes all carry the same
+ * tag; it is shared read-only by every table slot it is installed in (refs
+ * counts them and is only updated with __sync atomics) and is split into a
+ * private tag_page_t on the first write of a different tag. Table slots
+ * point to it with the low bit set. Pages unlinked from a slot are freed in
+ * batches of TAG_RETIRE_MAX while the application threads are stopped
+ */
+typedef struct {
+  tag_t tag;
+  size_t refs;
+} tag_uniform_t;
+
+#define PAGE_IS_UNIFORM(page) (((uintptr_t)(page)) & 1)
+#define PAGE2UNIFORM(page) ((tag_uniform_t *)((uintptr_t)(page) & ~(uintptr_t)1))
+#define UNIFORM2PAGE(u) ((tag_page_t *)((uintptr_t)(u) | 1))
+
+extern tag_dir_t tag_dir;
+
+inline tag_t tag_slot_load(tag_slot_t const &slot) {
+  return tag_page_traits<tag_t>::load(slot);
+}
+
+inline void tag_slot_store(tag_slot_t &slot, tag_t const &tag) {
+  tag_page_traits<tag_t>::store(slot, tag);
+}
+
+/*
+ * true if no byte of [addr, addr + n) can be tainted; n must not exceed
+ * PAGE_SIZE, so the range spans at most two pages
+ */
+inline bool tagmap_range_clean(ADDRINT addr, size_t n) {
+  uint64_t const *map = tag_dir.taint_map;
+  if (likely(map == NULL))
+    return true;
+  ADDRINT last = addr + n - 1;
+  if (unlikely(last > USER_ADDR_MAX))
+    return false;
+  uint64_t pg = addr >> PAGE_BITS, pg_last = last >> PAGE_BITS;
+  return !((map[pg >> 6] >> (pg & 63)) & 1) &&
+         !((map[pg_last >> 6] >> (pg_last & 63)) & 1);
+}
+
 void tagmap_setb(ADDRINT addr, tag_t const &tag);
 void tagmap_setb_reg(THREADID tid, unsigned int reg_idx, unsigned int off,
                      tag_t const &tag);
+void tagmap_setn(ADDRINT addr, size_t n, tag_t const &tag);
+void tagmap_setn_offsets(ADDRINT addr, size_t n, unsigned int offset,
+                         THREADID tid);
+void tagmap_setn_range(ADDRINT addr, size_t n, unsigned int offset,
+                       THREADID tid);
 tag_t tagmap_getb(ADDRINT addr);
+void tagmap_getw(ADDRINT addr, size_t n, tag_t *tags);
+void tagmap_setw(ADDRINT addr, size_t n, tag_t const *tags);
 tag_t tagmap_getb_reg(THREADID tid, unsigned int reg_idx, unsigned int off);
-tag_t tagmap_getn(ADDRINT addr, unsigned int size);
+tag_t tagmap_getn(ADDRINT addr, unsigned int size, THREADID tid);
 tag_t tagmap_getn_reg(THREADID tid, unsigned int reg_idx, unsigned int n);
 void tagmap_clrb(ADDRINT addr);
 void tagmap_clrn(ADDRINT, UINT32);
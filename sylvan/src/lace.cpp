@@ -22,6 +22,7 @@
 #include <stdlib.h> // for memalign, malloc
 #include <string.h> // for memset
 #include <sys/time.h> // for gettimeofday
+#include <setjmp.h> // for jmp_buf
 #include "sylvan_tls.h"
 
 #include "lace.h"
@@ -84,8 +85,28 @@ static size_t workers_memory_size = 0;
  */
 static WorkerP **workers_p;
 
-static SSA_Task *ssa_p;//与外部通信
+static SSA_Task *ssa_p;//与外部通信，每个app线程一个
+static uint64_t volatile ssa_n_slots;//已经分配的ssa_p数量
+static uint64_t ssa_max_slots;
+/*
+BDD worker池：ssa_pool_size为0时每个app线程一个worker，否则最多ssa_pool_size个
+worker，app线程i由worker i % ssa_pool_size服务
+*/
+typedef struct
+{
+    uint64_t volatile sleeping;//必须是第一个成员，SSA_Task::park指向它
+    PIN_SEMAPHORE sem;
+} __attribute__((aligned(LINE_SIZE))) SSA_Pool;
+static SSA_Pool *ssa_pool;
+static uint64_t ssa_pool_size;
+static uint64_t ssa_pool_n;//已经启动的worker数量
+static int volatile ssa_pool_quit;
+static SSA_Ring *ssa_ring;//异步合并请求
 static sylvan_tcb_t *lace_worker_tls;
+#if SSA_INLINE_OPS
+static sylvan_tcb_t *ssa_inline_tls;//app线程内联执行时使用的tls，与worker的region互不干扰
+static WorkerP *ssa_inline_wp;
+#endif
 
 static uint64_t spawn_exit_lock;
 
@@ -321,87 +342,480 @@ lace_steal_external(WorkerP *self, Task *dq_head)
     }
 }
 
-VOID_TASK_1(lace_steal_loop_ex, int*, quit)
+#if defined(SSA_PROFILE) && SSA_BENCH_OR
+/*
+ * Union of l and r with both sylvan_or_alone and the former not/and/not formulation,
+ * timing each on the live tag sets. The order alternates so that neither always runs
+ * on the nodes the other one just created.
+ */
+TASK_3(BDD, ssa_bench_or, SSA_Task *, t, BDD, l, BDD, r)
 {
-    // Determine who I am
-    const int worker_id = __lace_worker->worker;
-    SSA_Task *t = &ssa_p[worker_id];
-    while(*(volatile int*)quit == 0) {
+    BDD o, a;
+    uint64_t c0 = __builtin_ia32_rdtsc();
+    if (t->bench_count++ & 1) {
+        a = sylvan_not(CALL(sylvan_and_alone, sylvan_not(l), sylvan_not(r), 0));
+        uint64_t c1 = __builtin_ia32_rdtsc();
+        bdd_refs_push(a);
+        o = CALL(sylvan_or_alone, l, r, 0);
+        bdd_refs_pop(1);
+        t->bench_or += __builtin_ia32_rdtsc() - c1;
+        t->bench_andnot += c1 - c0;
+    } else {
+        o = CALL(sylvan_or_alone, l, r, 0);
+        uint64_t c1 = __builtin_ia32_rdtsc();
+        bdd_refs_push(o);
+        a = sylvan_not(CALL(sylvan_and_alone, sylvan_not(l), sylvan_not(r), 0));
+        bdd_refs_pop(1);
+        t->bench_andnot += __builtin_ia32_rdtsc() - c1;
+        t->bench_or += c1 - c0;
+    }
+    if (o != a)
+        t->bench_diff++;
+    return o;
+}
+#endif
+
+#if SSA_INLINE_OPS
+/*
+ * Run one request of t on the calling app thread with the nogc kernels; type is the
+ * task_type the worker would see, the operands are in t->arg1/arg2 as usual.
+ * Nodes are claimed from a region of our own, through ssa_inline_tls. If the unique
+ * table fills up, _mtbdd_makenode_nogc longjmps back here and 0 is returned: the
+ * request has to go to the worker then, which can start a gc. Partial results are
+ * discarded, the worker recomputes the whole request.
+ */
+int lace_ssa_inline(SSA_Task *t, uint64_t type)
+{
+    const unsigned int id = t - ssa_p;
+    sylvan_tcb_t *tcb = &ssa_inline_tls[id];
+    WorkerP *__lace_worker = &ssa_inline_wp[id];
+    Task *__lace_dq_head = NULL;
+    jmp_buf full;
+    volatile int ok = 1;
+
+    uint64_t old_fs = _readfsbase_u64();
+    _writefsbase_u64((uint64_t)tcb);
+    tcb->slots[inline_abort_slot] = (uintptr_t)&full;
+    if (setjmp(full) == 0)
+    {
+        switch (type)
+        {
+        case 1:
+            t->res = mtbdd_cube_nogc(t->arg1,(uint8_t *)t->arg2,mtbdd_true);
+            break;
+        case 2:
+            t->res = CALL(sylvan_or_nogc_alone,t->arg1,t->arg2,0);
+            t->size = ~0ULL;
+            break;
+        case 3:
+        {
+            SSA_Batch *b = (SSA_Batch *)t->arg2;
+            uint8_t cube[64];
+            for (uint64_t i = 0; i < b->count; i++)
+            {
+                uint64_t offset = b->offset + i;
+                for (uint64_t k = 0; k < b->width; k++)
+                    cube[b->order[k]] = (offset >> k) & 0x1;
+                uint64_t *dst = (uint64_t *)((char *)b->dst[i] + b->dst_off);
+                *dst = mtbdd_cube_nogc(t->arg1,cube,mtbdd_true);
+            }
+            break;
+        }
+        case 4:
+        {
+            SSA_Range *r = (SSA_Range *)t->arg2;
+            t->res = mtbdd_interval_nogc(t->arg1,r->order,r->lo,r->hi);
+            break;
+        }
+        case 5:
+        {
+            SSA_Union *u = (SSA_Union *)t->arg2;
+            t->res = CALL(sylvan_or_n_nogc_alone,u->ops,u->count);
+            break;
+        }
+        case 6:
+        {
+            SSA_Pairs *p = (SSA_Pairs *)t->arg2;
+            for (uint64_t i = 0; i < p->count; i++)
+                p->res[i] = CALL(sylvan_or_nogc_alone,p->l[i],p->r[i],0);
+            break;
+        }
+        default:
+            assert(false);
+        }
+    }
+    else
+    {
+        ok = 0;
+    }
+    tcb->slots[inline_abort_slot] = 0;
+    _writefsbase_u64(old_fs);
+    return ok;
+}
+
+/*
+ * After a gc every region is free again, the regions recorded in the inline tls have
+ * to be forgotten just like the workers' ones (llmsset_reset_region). Called while no
+ * inline request is running.
+ */
+void lace_ssa_inline_reset()
+{
+    for (uint64_t i = 0; i < ssa_n_slots; i++)
+        ssa_inline_tls[i].slots[my_region_slot] = -1;
+}
+#endif
+
+#ifndef SSA_NOGC
+#if PARALLEL_COMBINE_ENABLE
+//所有worker共享，只用CAS更新
+static uint64_t volatile ssa_par_threshold = PARALLEL_COMBINE_THRESHOLD;
+static uint64_t volatile ssa_seq_cost;//顺序合并每单位大小估计的周期数，左移4位
+static uint64_t volatile ssa_par_active;//正在执行的并行合并数，不为0时helper参与steal
+#endif
+
+/*
+ * Union of l and r. hint is the smaller of the two operand size estimates: when both
+ * operands are larger than ssa_par_threshold the union runs as not(and(not l, not r)),
+ * whose work-stealing recursion the helpers join; everything else stays on this worker.
+ * The threshold tunes itself: every parallel union is compared with the time the
+ * sequential kernel would have needed for the same hint, measured on earlier unions.
+ * *steps is the recursion count of the sequential kernel, all ones when the parallel
+ * path was taken. Together with the larger operand it bounds the size of the result
+ * better than the sum of both; subgraphs taken over unchanged are not counted.
+ */
+TASK_4(BDD, ssa_combine_sized, BDD, l, BDD, r, uint64_t, hint, uint64_t *, steps)
+{
+    BDD res;
+#if PARALLEL_COMBINE_ENABLE
+    uint64_t c0 = __builtin_ia32_rdtsc();
+    if (helper_count > 0 && hint > ssa_par_threshold && ssa_seq_cost != 0)
+    {
+        if (__sync_fetch_and_add(&ssa_par_active, 1) == 0)
+            PIN_SemaphoreSet(&sem_helpers);
+        res = sylvan_not(CALL(sylvan_and, sylvan_not(l), sylvan_not(r), 0));
+        /*
+        gc期间由lace_run_newframe负责sem_helpers，持有spawn_exit_lock时才清除，
+        否则可能清除gc刚刚设置的信号，helper无法参与gc的barrier
+        */
+        if (__sync_sub_and_fetch(&ssa_par_active, 1) == 0 &&
+            __sync_bool_compare_and_swap(&spawn_exit_lock, 0, 1))
+        {
+            if (ssa_par_active == 0)
+                PIN_SemaphoreClear(&sem_helpers);
+            mfence();
+            spawn_exit_lock = 0;
+        }
+        uint64_t c = (__builtin_ia32_rdtsc() - c0) << 4;
+        bool faster = c < ssa_seq_cost * hint;
+        uint64_t old, th;
+        do
+        {
+            old = ssa_par_threshold;
+            th = faster ? old - old / 16 : old + old / 16;
+            th = th < PARALLEL_COMBINE_MIN ? PARALLEL_COMBINE_MIN : th > PARALLEL_COMBINE_MAX ? PARALLEL_COMBINE_MAX : th;
+        } while (!__sync_bool_compare_and_swap(&ssa_par_threshold, old, th));
+        *steps = ~0ULL;
+        return res;
+    }
+#endif
+    uint64_t n = 0;
+    res = CALL(sylvan_or_alone_profile, l, r, 0, &n);
+#if PARALLEL_COMBINE_ENABLE
+    //只用足够大的合并估计顺序执行的代价，小合并主要是固定开销
+    if (hint >= PARALLEL_COMBINE_MIN)
+    {
+        int64_t sample = (int64_t)(((__builtin_ia32_rdtsc() - c0) << 4) / hint);
+        uint64_t old;
+        int64_t cost;
+        do
+        {
+            old = ssa_seq_cost;
+            cost = (int64_t)old;
+            cost = cost == 0 ? sample : cost + (sample - cost) / 8;
+        } while (!__sync_bool_compare_and_swap(&ssa_seq_cost, old, (uint64_t)cost));
+    }
+#endif
+    *steps = n;
+    return res;
+}
+#endif
+
+/*
+ * Serve the requests of one app thread: the synchronous request in t, if any, and the
+ * first entry of its ring. Returns 0 if there was nothing to do.
+ */
+TASK_1(int, lace_ssa_serve, SSA_Task *, t)
+{
+    int work = t->task_type != 0;
 #ifdef SSA_PROFILE
     uint64_t cb_count = 0;
 #endif
-        //mtbdd_cube
-        if (t->task_type ==1)
+    //mtbdd_cube
+    if (t->task_type ==1)
+    {
+#ifdef SSA_NOGC
+        t->res = mtbdd_cube_nogc(t->arg1,(uint8_t *)t->arg2,mtbdd_true);
+#else
+        t->res = mtbdd_cube(t->arg1,(uint8_t *)t->arg2,mtbdd_true);
+#endif
+        mfence();
+        t->task_type = 0;
+    }
+    //batched mtbdd_cube
+    if (t->task_type ==3)
+    {
+        SSA_Batch *b = (SSA_Batch *)t->arg2;
+        uint8_t cube[64];
+        for (uint64_t i = 0; i < b->count; i++)
         {
+            uint64_t offset = b->offset + i;
+            for (uint64_t k = 0; k < b->width; k++)
+                cube[b->order[k]] = (offset >> k) & 0x1;
+            uint64_t *dst = (uint64_t *)((char *)b->dst[i] + b->dst_off);
 #ifdef SSA_NOGC
-            t->res = mtbdd_cube_nogc(t->arg1,(uint8_t *)t->arg2,mtbdd_true);
+            *dst = mtbdd_cube_nogc(t->arg1,cube,mtbdd_true);
 #else
-            t->res = mtbdd_cube(t->arg1,(uint8_t *)t->arg2,mtbdd_true);
+            /* dst is protected by the caller, so earlier results survive a gc here */
+            *dst = mtbdd_cube(t->arg1,cube,mtbdd_true);
 #endif
-            mfence();
-            t->task_type = 0;
         }
-        //bdd_combine
-        if (t->task_type ==2)
+        mfence();
+        t->task_type = 0;
+    }
+    //interval of offsets
+    if (t->task_type ==4)
+    {
+        SSA_Range *r = (SSA_Range *)t->arg2;
+#ifdef SSA_NOGC
+        t->res = mtbdd_interval_nogc(t->arg1,r->order,r->lo,r->hi);
+#else
+        t->res = mtbdd_interval(t->arg1,r->order,r->lo,r->hi);
+#endif
+        mfence();
+        t->task_type = 0;
+    }
+    //n-ary bdd_combine
+    if (t->task_type ==5)
+    {
+        SSA_Union *u = (SSA_Union *)t->arg2;
+#ifdef SSA_NOGC
+        t->res = CALL(sylvan_or_n_nogc_alone,u->ops,u->count);
+#else
+        t->res = CALL(sylvan_or_n_alone,u->ops,u->count);
+#endif
+        mfence();
+        t->task_type = 0;
+    }
+    //batched bdd_combine
+    if (t->task_type ==6)
+    {
+        SSA_Pairs *p = (SSA_Pairs *)t->arg2;
+        for (uint64_t i = 0; i < p->count; i++)
         {
-            BDD res;
 #ifdef SSA_NOGC
-    #if PARALLEL_COMBINE_ENABLE
-            if (unlikely(mtbdd_nodecount2(t->arg1)>PARALLEL_COMBINE_THRESHOLD 
-                && mtbdd_nodecount2(t->arg2)>PARALLEL_COMBINE_THRESHOLD && helper_count>0))
-            {
-                PIN_SemaphoreSet(&sem_helpers);
-                res = CALL(sylvan_and_nogc,sylvan_not(t->arg1), sylvan_not(t->arg2), 0);
-                PIN_SemaphoreClear(&sem_helpers);
-            }
-            else
-                res = CALL(sylvan_and_nogc_alone,sylvan_not(t->arg1), sylvan_not(t->arg2), 0);
+            p->res[i] = CALL(sylvan_or_nogc_alone,p->l[i],p->r[i],0);
+#else
+            /* earlier results must survive a gc triggered by later lanes */
+            p->res[i] = CALL(sylvan_or_alone,p->l[i],p->r[i],0);
+            bdd_refs_push(p->res[i]);
+#endif
+        }
+#ifndef SSA_NOGC
+        bdd_refs_pop(p->count);
+#endif
+        mfence();
+        t->task_type = 0;
+    }
+    //async bdd_combine, one request per round so that a pending gc is not delayed
+    SSA_Ring *ring = t->ring;
+    SSA_Req *q = &ring->q[ring->_h % SSA_RING_SIZE];
+    /*
+     * operands produced by another thread's ring may still be pending, and that ring may
+     * be served by this very worker: leave the entry for a later round instead of waiting.
+     * The earliest pending request of all rings never waits, so this cannot livelock.
+     */
+    if (ring->_h != ring->_t && *q->l != SSA_BDD_PENDING && *q->r != SSA_BDD_PENDING)
+    {
+        work = 1;
+        BDD res;
+#ifdef SSA_NOGC
+        res = CALL(sylvan_or_nogc_alone,*q->l, *q->r, 0);
+#elif defined(SSA_PROFILE) && SSA_BENCH_OR
+        res = CALL(ssa_bench_or,t,*q->l, *q->r);
+#else
+        uint64_t steps;
+        res = CALL(ssa_combine_sized,*q->l, *q->r, q->hint, &steps);
+        uint64_t est = steps > q->floor ? steps : q->floor;
+        if (est < *q->size)
+            *q->size = est;
+    #ifdef SSA_PROFILE
+        if (steps != ~0ULL)
+            t->cb_count += steps;
+    #endif
+#endif
+        /* dst is protected by the app thread */
+        *q->dst = res;
+        mfence();
+        ring->_h++;
+    }
+    //bdd_combine
+    if (t->task_type ==2)
+    {
+        BDD res;
+#ifdef SSA_NOGC
+    #if PARALLEL_COMBINE_ENABLE && MTBDD_NODE_COUNTING
+        if (unlikely(mtbdd_nodecount2(t->arg1)>PARALLEL_COMBINE_THRESHOLD 
+            && mtbdd_nodecount2(t->arg2)>PARALLEL_COMBINE_THRESHOLD && helper_count>0))
+        {
+            PIN_SemaphoreSet(&sem_helpers);
+            res = sylvan_not(CALL(sylvan_and_nogc,sylvan_not(t->arg1), sylvan_not(t->arg2), 0));
+            PIN_SemaphoreClear(&sem_helpers);
+        }
+        else
+            res = CALL(sylvan_or_nogc_alone,t->arg1, t->arg2, 0);
     #else
-            res = CALL(sylvan_and_nogc_alone,sylvan_not(t->arg1), sylvan_not(t->arg2), 0);
+        res = CALL(sylvan_or_nogc_alone,t->arg1, t->arg2, 0);
     #endif
+        t->size = ~0ULL;
+#elif defined(SSA_PROFILE) && SSA_BENCH_OR
+        res = CALL(ssa_bench_or,t,t->arg1, t->arg2);
+        t->size = ~0ULL;
 #else
-    #if PARALLEL_COMBINE_ENABLE            
-            if (unlikely(mtbdd_nodecount2(t->arg1)>PARALLEL_COMBINE_THRESHOLD 
-                && mtbdd_nodecount2(t->arg2)>PARALLEL_COMBINE_THRESHOLD && helper_count>0))
-            {
-                PIN_SemaphoreSet(&sem_helpers);
-                res = CALL(sylvan_and,sylvan_not(t->arg1), sylvan_not(t->arg2), 0);
-                PIN_SemaphoreClear(&sem_helpers);
-            }
-            else
-            {
-        #ifdef SSA_PROFILE
-                res = CALL(sylvan_and_alone_profile,sylvan_not(t->arg1), sylvan_not(t->arg2), 0,&cb_count);
-        #else
-                res = CALL(sylvan_and_alone,sylvan_not(t->arg1), sylvan_not(t->arg2), 0);
-        #endif
-            }
-    #else
-        #ifdef SSA_PROFILE
-                res = CALL(sylvan_and_alone_profile,sylvan_not(t->arg1), sylvan_not(t->arg2), 0,&cb_count);
-        #else
-                res = CALL(sylvan_and_alone,sylvan_not(t->arg1), sylvan_not(t->arg2), 0);
-        #endif
+        uint64_t steps;
+        res = CALL(ssa_combine_sized,t->arg1, t->arg2, t->size, &steps);
+        t->size = steps;
+    #ifdef SSA_PROFILE
+        if (steps != ~0ULL)
+            cb_count = steps;
+    #endif
+#endif
+        t->res = res;
+#ifdef SSA_PROFILE
+        t->l_count1 = mtbdd_nodecount(t->arg1);
+        t->r_count1 = mtbdd_nodecount(t->arg2);
+#if MTBDD_NODE_COUNTING
+        t->l_count2 = mtbdd_nodecount2(t->arg1);
+        t->r_count2 = mtbdd_nodecount2(t->arg2);
+#endif
+        t->cb_count = cb_count;
 #endif
+        mfence();
+        t->task_type = 0;
+    }
+
+    return work;
+}
+
+/*
+ * Pool mode: the app thread of t is leaving, its ring is already drained. Like a worker
+ * that quits, hold spawn_exit_lock so that this does not overlap with a gc.
+ */
+VOID_TASK_1(lace_ssa_leave, SSA_Task *, t)
+{
+    while (!__sync_bool_compare_and_swap(&spawn_exit_lock,0,1))
+    {
+        YIELD_NEWFRAME();
+    }
+    int *quit = t->quit;
+    mtbdd_unprotect(&t->res);
+    t->quit = NULL;
+    mfence();
+    spawn_exit_lock = 0;
+    *quit = 0;
+}
+
+#if SSA_WORKER_IDLE_SPIN
+//worker p负责的线程中是否有待处理的请求，或者需要worker参与的gc
+static int ssa_pool_pending(uint64_t p, uint64_t stride)
+{
+    if (*(Task* volatile *)&lace_newframe.t != NULL || ssa_pool_quit)
+        return 1;
+    for (uint64_t s = p; s < ssa_n_slots; s += stride)
+    {
+        SSA_Task *t = &ssa_p[s];
+        int *quit = t->quit;
+        if (quit != NULL && (*(volatile int*)quit != 0 || t->task_type != 0 || t->ring->_h != t->ring->_t))
+            return 1;
+    }
+    return 0;
+}
+
+/*
+置位sleeping之后再检查一次：之后提交的请求（lace_ssa_kick）和gc（ssa_pool_wake_all）
+一定能看到sleeping并唤醒worker
+*/
+static void ssa_pool_park(uint64_t p, uint64_t stride)
+{
+    SSA_Pool *w = &ssa_pool[p];
+    PIN_SemaphoreClear(&w->sem);
+    w->sleeping = 1;
+    mfence();
+    if (!ssa_pool_pending(p, stride))
+        PIN_SemaphoreWait(&w->sem);
+    w->sleeping = 0;
+}
 
+void lace_ssa_wake(SSA_Task *t)
+{
+    PIN_SemaphoreSet(&((SSA_Pool *)t->park)->sem);
+}
 
+static void ssa_pool_wake_all()
+{
+    for (uint64_t p = 0; p < ssa_pool_n; p++)
+        if (ssa_pool[p].sleeping)
+            PIN_SemaphoreSet(&ssa_pool[p].sem);
+}
 #endif
-            t->res = sylvan_not(res);
-#ifdef SSA_PROFILE
-            t->l_count1 = mtbdd_nodecount(t->arg1);
-            t->r_count1 = mtbdd_nodecount(t->arg2);
-    #if MTBDD_NODE_COUNTING
-            t->l_count2 = mtbdd_nodecount2(t->arg1);
-            t->r_count2 = mtbdd_nodecount2(t->arg2);
-    #endif
-            t->cb_count = cb_count;
+
+/*
+pool worker p负责下标为p, p + stride, ...的app线程；每个app线程一个worker时
+只负责线程p，并随它一起退出
+*/
+VOID_TASK_1(lace_steal_loop_ex, uint64_t, p)
+{
+    const uint64_t stride = ssa_pool_size != 0 ? ssa_pool_size : ssa_max_slots;
+    int *leave = NULL;
+#if SSA_WORKER_IDLE_SPIN
+    uint64_t idle = 0;
 #endif
-            mfence();
-            t->task_type = 0;
+    while (*(volatile int*)&ssa_pool_quit == 0) {
+        int work = 0;
+        for (uint64_t s = p; s < ssa_n_slots; s += stride)
+        {
+            SSA_Task *t = &ssa_p[s];
+            int *quit = t->quit;
+            if (quit == NULL)
+                continue;
+            //app线程退出前已经等待ring清空
+            if (*(volatile int*)quit != 0)
+            {
+                if (ssa_pool_size == 0)
+                {
+                    leave = quit;
+                    break;
+                }
+                CALL(lace_ssa_leave, t);
+                continue;
+            }
+            work |= CALL(lace_ssa_serve, t);
         }
+        if (leave != NULL)
+            break;
 
         YIELD_NEWFRAME();
 
+#if SSA_WORKER_IDLE_SPIN
+        //先自旋，长时间没有请求时休眠，直到有新的请求或gc
+        if (work)
+            idle = 0;
+        else if (++idle > SSA_WORKER_IDLE_SPIN)
+        {
+            ssa_pool_park(p, stride);
+            idle = 0;
+        }
+#endif
+
         //for debug
         if (unlikely(external_task != 0)) {
             assert(false);
@@ -417,8 +831,11 @@ VOID_TASK_1(lace_steal_loop_ex, int*, quit)
         YIELD_NEWFRAME();
     }
 
-    mtbdd_unprotect(&ssa_p[worker_id].res);
-    *ssa_p[worker_id].quit = 0;
+    if (leave != NULL)
+    {
+        mtbdd_unprotect(&ssa_p[p].res);
+        *leave = 0;
+    }
     lace_n_workers_alive--;
     mfence();
     compiler_barrier();
@@ -491,7 +908,7 @@ lace_worker_thread(void* arg)
     // Run the steal loop
     WorkerP *__lace_worker = lace_get_worker();
     Task *__lace_dq_head = lace_get_head(__lace_worker);
-    lace_steal_loop_ex_WORK(__lace_worker, __lace_dq_head, ssa_p[worker].quit);
+    lace_steal_loop_ex_WORK(__lace_worker, __lace_dq_head, worker - helper_count);
     return;
 }
 
@@ -568,9 +985,38 @@ SSA_Task* lace_spawn_worker(void *arg)
         lace_n_workers_alive = lace_n_workers_id;
         helper_inited = true;
     }
-    ssa_p[lace_n_workers_id].quit = (int *)arg;
-    mtbdd_protect(&ssa_p[lace_n_workers_id].res);
-    SSA_Task* res = &ssa_p[lace_n_workers_id];
+    const uint64_t slot = ssa_n_slots;
+    const uint64_t p = ssa_pool_size != 0 ? slot % ssa_pool_size : slot;
+    ssa_p[slot].quit = (int *)arg;
+    ssa_p[slot].ring = &ssa_ring[slot];
+    ssa_p[slot].park = &ssa_pool[p].sleeping;
+    ssa_ring[slot]._h = 0;
+    ssa_ring[slot]._t = 0;
+#ifdef SSA_PROFILE
+    ssa_p[slot].cb_count = 0;
+#endif
+    mtbdd_protect(&ssa_p[slot].res);
+#if SSA_INLINE_OPS
+    sylvan_tcb_t *i_tcb = &ssa_inline_tls[slot];
+    memset(i_tcb,0,sizeof(sylvan_tcb_t));
+    memset(&ssa_inline_wp[slot],0,sizeof(WorkerP));
+    ssa_inline_wp[slot].worker = slot;
+    i_tcb->slots[current_worker_slot] = (uintptr_t)&ssa_inline_wp[slot];
+    i_tcb->slots[my_region_slot] = -1;
+    i_tcb->slots[my_worker_id_slot] = slot;
+#endif
+    SSA_Task* res = &ssa_p[slot];
+    mfence();
+    ssa_n_slots = slot + 1;
+    //worker池已满，由已有的worker服务
+    if (p < ssa_pool_n)
+    {
+        spawn_exit_lock = 0;
+        return res;
+    }
+    ssa_pool[p].sleeping = 0;
+    PIN_SemaphoreInit(&ssa_pool[p].sem);
+    ssa_pool_n = p + 1;
     PIN_SpawnInternalThread(lace_worker_thread,(void*)(size_t)lace_n_workers_id,stacksize,NULL);
     return res;
 }
@@ -590,10 +1036,19 @@ lace_start(unsigned int max_workers, size_t dqsize, uint64_t helper_n)
         posix_memalign((void**)&workers_p, LINE_SIZE, max_workers*sizeof(WorkerP*)) != 0 ||
         posix_memalign((void**)&workers_memory, LINE_SIZE, max_workers*sizeof(worker_data*)) ||
         posix_memalign((void**)&lace_worker_tls, LINE_SIZE, max_workers*sizeof(sylvan_tcb_t))||
-        posix_memalign((void**)&ssa_p, LINE_SIZE, max_workers*sizeof(SSA_Task))!= 0) {
+        posix_memalign((void**)&ssa_p, LINE_SIZE, max_workers*sizeof(SSA_Task))!= 0 ||
+        posix_memalign((void**)&ssa_ring, LINE_SIZE, max_workers*sizeof(SSA_Ring))!= 0 ||
+        posix_memalign((void**)&ssa_pool, LINE_SIZE, max_workers*sizeof(SSA_Pool))!= 0) {
+        fprintf(stderr, "Lace error: unable to allocate memory!\n");
+        exit(1);
+    }
+#if SSA_INLINE_OPS
+    if (posix_memalign((void**)&ssa_inline_tls, LINE_SIZE, max_workers*sizeof(sylvan_tcb_t)) != 0 ||
+        posix_memalign((void**)&ssa_inline_wp, LINE_SIZE, max_workers*sizeof(WorkerP)) != 0) {
         fprintf(stderr, "Lace error: unable to allocate memory!\n");
         exit(1);
     }
+#endif
 
     // Compute memory size for each worker
     workers_memory_size = sizeof(worker_data) + sizeof(Task) * dqsize;
@@ -603,15 +1058,42 @@ lace_start(unsigned int max_workers, size_t dqsize, uint64_t helper_n)
 
     PIN_SemaphoreInit(&sem_helpers);
     helper_count = helper_n;
+
+    ssa_max_slots = max_workers;
+    ssa_n_slots = 0;
+    ssa_pool_n = 0;
+    ssa_pool_quit = 0;
+#if SSA_POOL_WORKERS < 0
+    //每个可用的cpu一个worker
+    cpu_set_t cpus;
+    if (sched_getaffinity(0, sizeof(cpus), &cpus) == 0)
+        ssa_pool_size = CPU_COUNT(&cpus);
+    else
+        ssa_pool_size = 1;
+#else
+    ssa_pool_size = SSA_POOL_WORKERS;
+#endif
+    if (ssa_pool_size > max_workers)
+        ssa_pool_size = max_workers;
 }
 
 void lace_stop()
 {
     helper_quit = 1;
     PIN_SemaphoreSet(&sem_helpers);
+    //池中的worker不随app线程退出
+    if (ssa_pool_size != 0)
+    {
+        ssa_pool_quit = 1;
+        mfence();
+        for (uint64_t p = 0; p < ssa_pool_n; p++)
+            PIN_SemaphoreSet(&ssa_pool[p].sem);
+    }
     while (lace_n_workers_alive != 0)
         ;
     PIN_SemaphoreFini(&sem_helpers);
+    for (uint64_t p = 0; p < ssa_pool_n; p++)
+        PIN_SemaphoreFini(&ssa_pool[p].sem);
     
     // finally, destroy the barriers
     lace_barrier_destroy();
@@ -634,7 +1116,13 @@ void lace_stop()
     workers_memory = 0;
 
     free(ssa_p);
+    free(ssa_ring);
+    free(ssa_pool);
     free(lace_worker_tls);
+#if SSA_INLINE_OPS
+    free(ssa_inline_tls);
+    free(ssa_inline_wp);
+#endif
 }
 
 
@@ -764,6 +1252,10 @@ VOID_TASK_1(lace_wrap_together, Task*, task)
         if (__atomic_compare_exchange_n(&lace_newframe.t, &expected, &_t2, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) break;
         lace_yield(__lace_worker, __lace_dq_head);
     }
+#if SSA_WORKER_IDLE_SPIN
+    //休眠的worker也要参与新的frame
+    ssa_pool_wake_all();
+#endif
 
     // wait until other workers have made a local copy
     lace_barrier();
@@ -800,6 +1292,10 @@ VOID_TASK_1(lace_wrap_newframe, Task*, task)
         if (__atomic_compare_exchange_n(&lace_newframe.t, &expected, &_s, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) break;
         lace_yield(__lace_worker, __lace_dq_head);
     }
+#if SSA_WORKER_IDLE_SPIN
+    //休眠的worker也要参与新的frame
+    ssa_pool_wake_all();
+#endif
 
     // wait until other workers have made a local copy
     lace_barrier();
@@ -19,6 +19,7 @@
 #include <unistd.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <sylvan_config.h>
 
 #ifndef __LACE_H__
 #define __LACE_H__
@@ -97,6 +98,34 @@ void lace_start(unsigned int max_workers, size_t dqsize, uint64_t helper_n);
  */
 void lace_stop(void);
 
+/*
+ * Asynchronous combine ring, one producer (the app thread) and one consumer (its worker).
+ * The worker waits until *l and *r are no longer SSA_BDD_PENDING, stores their union
+ * to *dst and advances _h. _h and _t only grow, the slot is index % SSA_RING_SIZE.
+ * hint and floor are the smaller and the larger size estimate of the operands; *size
+ * holds the estimate of the result (their sum) and is lowered by the worker to
+ * max(floor, recursion count) once the union has been computed.
+ */
+typedef struct
+{
+    uint64_t volatile *l;
+    uint64_t volatile *r;
+    uint64_t volatile *dst;
+    uint64_t hint;
+    uint64_t floor;
+    uint64_t volatile *size;
+    uint64_t pading[2];
+}SSA_Req;
+
+typedef struct
+{
+    uint64_t volatile _h;
+    uint64_t pading[7];
+    uint64_t volatile _t;
+    uint64_t pading2[7];
+    SSA_Req q[SSA_RING_SIZE];
+}SSA_Ring;
+
 typedef struct 
 {
     uint64_t volatile task_type;
@@ -104,7 +133,9 @@ typedef struct
     uint64_t arg2;
     uint64_t res;
     int * quit;
-    uint64_t pading[3];
+    SSA_Ring *ring;
+    uint64_t volatile *park;//服务该线程的worker正在休眠时不为0
+    uint64_t size;//task_type 2：两个操作数大小估计中较小的一个；完成后为顺序合并的递归次数，未知时为全1
 #ifdef SSA_PROFILE
     uint64_t l_count1;
     uint64_t l_count2;
@@ -112,10 +143,70 @@ typedef struct
     uint64_t r_count2;
     uint64_t cb_count;
     uint64_t pading2[3];
+    /* SSA_BENCH_OR: requests compared, cycles of sylvan_or_alone and of not/and/not, results that differ */
+    uint64_t bench_count;
+    uint64_t bench_or;
+    uint64_t bench_andnot;
+    uint64_t bench_diff;
+    uint64_t pading3[4];
 #endif
 }SSA_Task;
 
+/*
+ * task_type 3: build one cube per input offset in [offset, offset + count),
+ * result i is stored to *(uint64_t *)((char *)dst[i] + dst_off).
+ * order[k] is the cube index of bit k of the offset.
+ */
+typedef struct
+{
+    uint64_t offset;
+    uint64_t count;
+    uint8_t *order;
+    uint64_t width;
+    void **dst;
+    uint64_t dst_off;
+}SSA_Batch;
+
+/*
+ * task_type 4: build the set of all input offsets in [lo, hi] as one bdd,
+ * order is the same as in SSA_Batch; the result is returned in res.
+ */
+typedef struct
+{
+    uint64_t lo;
+    uint64_t hi;
+    uint8_t *order;
+}SSA_Range;
+
+/*
+ * task_type 5: the union of ops[0..count) as one bdd, count <= SSA_UNION_MAX;
+ * the result is returned in res.
+ */
+typedef struct
+{
+    uint64_t count;
+    uint64_t ops[SSA_UNION_MAX];
+}SSA_Union;
+
+/*
+ * task_type 6: res[i] is the union of l[i] and r[i] for i in [0, count),
+ * count <= SSA_VEC_MAX; all lanes of one instruction in a single request.
+ * res is marked by the caller's gc mark callback until every lane has been
+ * stored, so the worker does not keep the results protected.
+ */
+typedef struct
+{
+    uint64_t count;
+    uint64_t l[SSA_VEC_MAX];
+    uint64_t r[SSA_VEC_MAX];
+    uint64_t res[SSA_VEC_MAX];
+}SSA_Pairs;
+
 SSA_Task* lace_spawn_worker(void *arg);
+#if SSA_INLINE_OPS
+int lace_ssa_inline(SSA_Task *t, uint64_t type);
+void lace_ssa_inline_reset();
+#endif
 
 extern unsigned int lace_n_workers_alive;
 extern unsigned int lace_n_workers_id;
@@ -306,6 +397,22 @@ void lace_yield(WorkerP *__lace_worker, Task *__lace_dq_head);
 #define unlikely(x)     __builtin_expect((x),0)
 #endif
 
+#if SSA_WORKER_IDLE_SPIN
+void lace_ssa_wake(SSA_Task *t);
+#endif
+
+/* 提交请求（task_type、ring或quit）之后调用：服务该线程的worker正在休眠时唤醒它 */
+static inline void lace_ssa_kick(SSA_Task *t)
+{
+#if SSA_WORKER_IDLE_SPIN
+    mfence();
+    if (unlikely(*t->park != 0))
+        lace_ssa_wake(t);
+#else
+    (void)t;
+#endif
+}
+
 #if LACE_PIE_TIMES
 /* High resolution timer */
 static inline uint64_t gethrtime()
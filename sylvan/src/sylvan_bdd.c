@@ -515,6 +515,208 @@ TASK_IMPL_4(BDD, sylvan_and_alone_profile, BDD, a, BDD, b, BDDVAR, prev_level,ui
     return result;
 }
 
+/**
+ * Subset check for sylvan_or_*, a <= b, visiting at most *budget nodes.
+ * Returns 0 when a is not a subset of b or the budget runs out.
+ */
+static int
+bdd_subset_bounded(BDD a, BDD b, int *budget)
+{
+    if (a == sylvan_false || b == sylvan_true || a == b) return 1;
+    if (a == sylvan_true || b == sylvan_false || a == BDD_TOGGLEMARK(b)) return 0;
+    if (--(*budget) < 0) return 0;
+
+    bddnode_t na = MTBDD_GETNODE(a);
+    bddnode_t nb = MTBDD_GETNODE(b);
+    BDDVAR va = bddnode_getvariable(na);
+    BDDVAR vb = bddnode_getvariable(nb);
+    BDDVAR level = va < vb ? va : vb;
+
+    BDD aLow = a, aHigh = a;
+    BDD bLow = b, bHigh = b;
+    if (level == va) {
+        aLow = node_low(a, na);
+        aHigh = node_high(a, na);
+    }
+    if (level == vb) {
+        bLow = node_low(b, nb);
+        bHigh = node_high(b, nb);
+    }
+    return bdd_subset_bounded(aHigh, bHigh, budget) && bdd_subset_bounded(aLow, bLow, budget);
+}
+
+/**
+ * Union of a and b when one of them contains the other, sylvan_invalid when that is not known.
+ */
+static BDD
+bdd_or_subsumed(BDD a, BDD b)
+{
+    int budget = BDD_OR_SUBSET_BUDGET;
+    if (budget == 0) return sylvan_invalid;
+    if (bdd_subset_bounded(a, b, &budget)) return b;
+    budget = BDD_OR_SUBSET_BUDGET;
+    if (bdd_subset_bounded(b, a, &budget)) return a;
+    return sylvan_invalid;
+}
+
+/**
+ * Shared body of sylvan_or_alone, sylvan_or_nogc_alone and sylvan_or_alone_profile.
+ * With gc set it may trigger garbage collection and keeps the partial result on the
+ * refs stack, otherwise it uses the nogc node constructor. count_addr, when not NULL,
+ * counts the recursive calls.
+ */
+TASK_5(BDD, sylvan_or_alone_rec, BDD, a, BDD, b, BDDVAR, prev_level, int, gc, uint64_t*, count_addr)
+{
+    if (count_addr != NULL) (*count_addr)++;
+    /* Terminal cases */
+    if (a == sylvan_false) return b;
+    if (b == sylvan_false) return a;
+    if (a == sylvan_true) return sylvan_true;
+    if (b == sylvan_true) return sylvan_true;
+    if (a == b) return a;
+    if (a == BDD_TOGGLEMARK(b)) return sylvan_true;
+
+    if (gc) sylvan_gc_test();
+
+    /* Count operation */
+    sylvan_stats_count(BDD_OR);
+
+    /* Improve for caching */
+    if (BDD_STRIPMARK(a) > BDD_STRIPMARK(b)) {
+        BDD t = b;
+        b = a;
+        a = t;
+    }
+
+    bddnode_t na = MTBDD_GETNODE(a);
+    bddnode_t nb = MTBDD_GETNODE(b);
+
+    BDDVAR va = bddnode_getvariable(na);
+    BDDVAR vb = bddnode_getvariable(nb);
+    BDDVAR level = va < vb ? va : vb;
+
+    int cachenow = granularity < 2 || prev_level == 0 ? 1 : prev_level / granularity != level / granularity;
+    if (cachenow) {
+        BDD result;
+        if (cache_get3(CACHE_BDD_OR, a, b, sylvan_false, &result)) {
+            sylvan_stats_count(BDD_OR_CACHED);
+            return result;
+        }
+    }
+
+    BDD low=sylvan_invalid, high=sylvan_invalid, result;
+
+    /* One operand usually contains the other, then the union is that operand */
+    if (prev_level == 0 && (result = bdd_or_subsumed(a, b)) != sylvan_invalid) {
+        if (cachenow) {
+            if (cache_put3(CACHE_BDD_OR, a, b, sylvan_false, result)) sylvan_stats_count(BDD_OR_CACHEDPUT);
+        }
+        return result;
+    }
+
+    // Get cofactors
+    BDD aLow = a, aHigh = a;
+    BDD bLow = b, bHigh = b;
+    if (level == va) {
+        aLow = node_low(a, na);
+        aHigh = node_high(a, na);
+    }
+    if (level == vb) {
+        bLow = node_low(b, nb);
+        bHigh = node_high(b, nb);
+    }
+
+    // Recursive computation
+    int n=0;
+
+    if (aHigh == sylvan_false) {
+        high = bHigh;
+    } else if (aHigh == sylvan_true || bHigh == sylvan_true) {
+        high = sylvan_true;
+    } else if (bHigh == sylvan_false) {
+        high = aHigh;
+    } else {
+        high = CALL(sylvan_or_alone_rec, aHigh, bHigh, level, gc, count_addr);
+        n=gc;
+    }
+
+    if (aLow == sylvan_false) {
+        low = bLow;
+    } else if (aLow == sylvan_true || bLow == sylvan_true) {
+        low = sylvan_true;
+    } else if (bLow == sylvan_false) {
+        low = aLow;
+    } else {
+        if (n) {bdd_refs_push(high);}
+        low = CALL(sylvan_or_alone_rec, aLow, bLow, level, gc, count_addr);
+        if (n) {bdd_refs_pop(1);}
+    }
+
+    /* The cofactors of an operand came back unchanged, reuse its node instead of a table lookup */
+    if (level == va && low == aLow && high == aHigh) {
+        result = a;
+    } else if (level == vb && low == bLow && high == bHigh) {
+        result = b;
+    } else {
+#if MTBDD_NODE_COUNTING
+        uint64_t count_low = MTBDD_GETNODE(low)->a& 0x1FFFFF0000000000;
+        uint64_t count_high = MTBDD_GETNODE(high)->a& 0x1FFFFF0000000000;
+        uint64_t count = count_low + count_high;
+        count += 0x10000000000;
+        high |= count;
+#endif
+        result = gc ? mtbdd_makenode(level, low, high) : mtbdd_makenode_nogc(level, low, high);
+    }
+
+    if (cachenow) {
+        if (cache_put3(CACHE_BDD_OR, a, b, sylvan_false, result)) sylvan_stats_count(BDD_OR_CACHEDPUT);
+    }
+
+    return result;
+}
+
+TASK_IMPL_3(BDD, sylvan_or_nogc_alone, BDD, a, BDD, b, BDDVAR, prev_level)
+{
+    return CALL(sylvan_or_alone_rec, a, b, prev_level, 0, NULL);
+}
+
+TASK_IMPL_3(BDD, sylvan_or_alone, BDD, a, BDD, b, BDDVAR, prev_level)
+{
+    return CALL(sylvan_or_alone_rec, a, b, prev_level, 1, NULL);
+}
+
+TASK_IMPL_4(BDD, sylvan_or_alone_profile, BDD, a, BDD, b, BDDVAR, prev_level,uint64_t *,count_addr)
+{
+    return CALL(sylvan_or_alone_rec, a, b, prev_level, 1, count_addr);
+}
+
+TASK_IMPL_2(BDD, sylvan_or_n_nogc_alone, BDD*, ops, size_t, n)
+{
+    if (n == 0) return sylvan_false;
+    if (n == 1) return ops[0];
+    size_t h = n / 2;
+    BDD l = CALL(sylvan_or_n_nogc_alone, ops, h);
+    BDD r = CALL(sylvan_or_n_nogc_alone, ops + h, n - h);
+    return CALL(sylvan_or_nogc_alone, l, r, 0);
+}
+
+/**
+ * The operands are kept alive by the caller, only the partial unions need to be pushed.
+ */
+TASK_IMPL_2(BDD, sylvan_or_n_alone, BDD*, ops, size_t, n)
+{
+    if (n == 0) return sylvan_false;
+    if (n == 1) return ops[0];
+    size_t h = n / 2;
+    BDD l = CALL(sylvan_or_n_alone, ops, h);
+    bdd_refs_push(l);
+    BDD r = CALL(sylvan_or_n_alone, ops + h, n - h);
+    bdd_refs_push(r);
+    BDD result = CALL(sylvan_or_alone, l, r, 0);
+    bdd_refs_pop(2);
+    return result;
+}
+
 TASK_IMPL_3(BDD, sylvan_xor, BDD, a, BDD, b, BDDVAR, prev_level)
 {
     /* Terminal cases */
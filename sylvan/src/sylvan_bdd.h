@@ -69,6 +69,13 @@ TASK_DECL_3(BDD, sylvan_and_nogc, BDD, BDD, BDDVAR);
 TASK_DECL_3(BDD, sylvan_and_alone, BDD, BDD, BDDVAR);
 TASK_DECL_3(BDD, sylvan_and_nogc_alone, BDD, BDD, BDDVAR);
 TASK_DECL_4(BDD, sylvan_and_alone_profile, BDD, BDD, BDDVAR,uint64_t*);
+/* Native disjunction for the combine worker, the same as sylvan_not(sylvan_and(sylvan_not(a), sylvan_not(b))) */
+TASK_DECL_3(BDD, sylvan_or_alone, BDD, BDD, BDDVAR);
+TASK_DECL_3(BDD, sylvan_or_nogc_alone, BDD, BDD, BDDVAR);
+TASK_DECL_4(BDD, sylvan_or_alone_profile, BDD, BDD, BDDVAR,uint64_t*);
+/* Union of ops[0..n), reduced as a balanced tree of sylvan_or_alone */
+TASK_DECL_2(BDD, sylvan_or_n_alone, BDD*, size_t);
+TASK_DECL_2(BDD, sylvan_or_n_nogc_alone, BDD*, size_t);
 #define sylvan_and(a,b) (RUN(sylvan_and,a,b,0))
 TASK_DECL_3(BDD, sylvan_xor, BDD, BDD, BDDVAR);
 #define sylvan_xor(a,b) (RUN(sylvan_xor,a,b,0))
@@ -30,5 +30,37 @@
 #endif
 
 #define MTBDD_NODE_COUNTING 0
+/* unions whose operands both have a size estimate above the threshold run in parallel with the helper threads;
+   the threshold starts at PARALLEL_COMBINE_THRESHOLD and tunes itself within [MIN, MAX].
+   Opt-in: needs HELPER_THREAD_NUM > 0 in ssa_tag.h */
 #define PARALLEL_COMBINE_ENABLE 0
-#define PARALLEL_COMBINE_THRESHOLD 2000
\ No newline at end of file
+#define PARALLEL_COMBINE_THRESHOLD 2000
+#define PARALLEL_COMBINE_MIN 256
+#define PARALLEL_COMBINE_MAX (1 << 20)
+
+/* sylvan_or_*: nodes visited by the subset check before the top-level recursion, 0 disables it */
+#define BDD_OR_SUBSET_BUDGET 64
+/* SSA_PROFILE: also run the old not/and/not combine on every request and time both against each other */
+#define SSA_BENCH_OR 0
+
+/* Asynchronous combine: requests per worker ring, and the bdd value of a result that is not computed yet (a union of two non-empty sets is never mtbdd_false) */
+#define SSA_RING_SIZE 64
+#define SSA_BDD_PENDING 0
+
+/* n-ary combine: operands per request */
+#define SSA_UNION_MAX 32
+
+/* vector combine: lane pairs per request, one per byte of a ymm register */
+#define SSA_VEC_MAX 32
+
+/* inline ops: the app thread runs its own bdd requests with the nogc kernels and only falls back to its worker when the unique table is full */
+#define SSA_INLINE_OPS 0
+/* bdd workers: 0 one per app thread, -1 one per available cpu, n at most n workers shared by all app threads */
+#define SSA_POOL_WORKERS 0
+/* idle rounds of a worker before it parks until the next request or gc, 0 spins forever;
+   only pooled workers park, a per-thread worker serves one client and would make it pay a wake-up after every pause */
+#if SSA_POOL_WORKERS != 0
+#define SSA_WORKER_IDLE_SPIN 0x10000
+#else
+#define SSA_WORKER_IDLE_SPIN 0
+#endif
\ No newline at end of file
@@ -19,6 +19,7 @@
 
 #include <inttypes.h>
 #include <math.h>
+#include <setjmp.h>
 #include <string.h>
 
 #include <sylvan_refs.h>
@@ -472,6 +473,8 @@ _mtbdd_makenode_nogc(uint32_t var, MTBDD low, MTBDD high)
     MTBDD result;
     uint64_t index = llmsset_lookup(nodes, n.a, n.b, &created);
     if (index == 0) {
+        LOCALIZE_THREAD_LOCAL(inline_abort, jmp_buf*);
+        if (inline_abort != NULL) longjmp(*inline_abort, 1);
         fprintf(stderr, "BDD Unique table full! Try again with more memory or use slow mode. Abort...\n");
         exit(1);
     }
@@ -724,6 +727,80 @@ mtbdd_cube(MTBDD variables, uint8_t *cube, MTBDD terminal)
     }
 }
 
+/**
+ * Comparison of a value against a bound, reading one bit per variable from the top.
+ * If the variables go from the most significant bit down, the first difference decides;
+ * otherwise every later difference overrides the earlier ones.
+ */
+#define ITV_LT 0
+#define ITV_EQ 1
+#define ITV_GT 2
+
+static inline int
+mtbdd_interval_step(int cmp, int xb, int bb, int msb_first)
+{
+    if (xb == bb || (msb_first && cmp != ITV_EQ)) return cmp;
+    return xb > bb ? ITV_GT : ITV_LT;
+}
+
+static MTBDD
+mtbdd_interval_build(MTBDD variables, uint8_t *order, uint64_t lo, uint64_t hi, int nogc)
+{
+    uint32_t vars[64];
+    uint32_t width = 0;
+    while (variables != mtbdd_true) {
+        mtbddnode_t n = MTBDD_GETNODE(variables);
+        vars[width++] = mtbddnode_getvariable(n);
+        variables = node_gethigh(variables, n);
+    }
+    if (width == 0) return lo <= hi ? mtbdd_true : mtbdd_false;
+
+    /* bit[k]: the bit of the value tested by the k-th variable */
+    uint32_t bit[64];
+    for (uint32_t k = 0; k < width; k++) bit[order[k]] = k;
+    int msb_first = bit[0] > bit[width - 1];
+
+    /* cur[a][b]: the sub-MTBDD below the current level, given the comparison
+       of the bits above against lo (a) and hi (b) */
+    MTBDD cur[3][3], nxt[3][3];
+    for (int a = 0; a < 3; a++)
+        for (int b = 0; b < 3; b++)
+            cur[a][b] = (a != ITV_LT && b != ITV_GT) ? mtbdd_true : mtbdd_false;
+
+    size_t pushed = 0;
+    for (uint32_t k = width; k-- > 0;) {
+        int lb = (lo >> bit[k]) & 1, hb = (hi >> bit[k]) & 1;
+        for (int a = 0; a < 3; a++) {
+            for (int b = 0; b < 3; b++) {
+                MTBDD low = cur[mtbdd_interval_step(a, 0, lb, msb_first)][mtbdd_interval_step(b, 0, hb, msb_first)];
+                MTBDD high = cur[mtbdd_interval_step(a, 1, lb, msb_first)][mtbdd_interval_step(b, 1, hb, msb_first)];
+                if (nogc) {
+                    nxt[a][b] = mtbdd_makenode_nogc(vars[k], low, high);
+                } else {
+                    nxt[a][b] = mtbdd_makenode(vars[k], low, high);
+                    mtbdd_refs_push(nxt[a][b]);
+                    pushed++;
+                }
+            }
+        }
+        memcpy(cur, nxt, sizeof(cur));
+    }
+    if (pushed) mtbdd_refs_pop(pushed);
+    return cur[ITV_EQ][ITV_EQ];
+}
+
+MTBDD
+mtbdd_interval(MTBDD variables, uint8_t *order, uint64_t lo, uint64_t hi)
+{
+    return mtbdd_interval_build(variables, order, lo, hi, 0);
+}
+
+MTBDD
+mtbdd_interval_nogc(MTBDD variables, uint8_t *order, uint64_t lo, uint64_t hi)
+{
+    return mtbdd_interval_build(variables, order, lo, hi, 1);
+}
+
 /**
  * Same as mtbdd_cube, but also performs "or" with existing MTBDD,
  * effectively adding an item to the set
@@ -372,6 +372,15 @@ void mtbdd_test_isset(MTBDD set);
 MTBDD mtbdd_cube(MTBDD variables, uint8_t *cube, MTBDD terminal);
 MTBDD mtbdd_cube_nogc(MTBDD variables, uint8_t *cube, MTBDD terminal);
 
+/**
+ * Create the MTBDD of all assignments whose value, read as an integer, lies in [lo, hi].
+ * Bit k of the value is the variable at position order[k] of <variables>.
+ * The variable order must follow the bit order (either increasing or decreasing
+ * significance); the result then has at most 9 nodes per variable.
+ */
+MTBDD mtbdd_interval(MTBDD variables, uint8_t *order, uint64_t lo, uint64_t hi);
+MTBDD mtbdd_interval_nogc(MTBDD variables, uint8_t *order, uint64_t lo, uint64_t hi);
+
 /**
  * Same as mtbdd_cube, but extends <mtbdd> with the assignment <cube> \to <terminal>.
  * If <mtbdd> already assigns a value to the cube, the new value <terminal> is taken.
@@ -51,6 +51,7 @@ struct
 
     {0, 0, "Operation            Count            Cache get        Cache put"},
     {2, BDD_AND, "BDD and"},
+    {2, BDD_OR, "BDD or"},
     {2, BDD_XOR, "BDD xor"},
     {2, BDD_ITE, "BDD ite"},
     {2, BDD_EXISTS, "BDD exists"},
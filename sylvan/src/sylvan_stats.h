@@ -36,6 +36,7 @@ typedef enum {
     /* BDD operations */
     OPCOUNTER(BDD_ITE),
     OPCOUNTER(BDD_AND),
+    OPCOUNTER(BDD_OR),
     OPCOUNTER(BDD_XOR),
     OPCOUNTER(BDD_EXISTS),
     OPCOUNTER(BDD_PROJECT),
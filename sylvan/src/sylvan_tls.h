@@ -24,6 +24,11 @@
 主线程调用llmsset_create，然后通过TOGETHER(llmsset_reset_region);在所有
 的work线程的tls中设置my_region
 */
+/*
+SSA_INLINE_OPS：app线程内联执行nogc算子时指向一个jmp_buf，唯一表满时longjmp回去，
+交给worker做gc后重算；worker线程中始终为0
+*/
+#define inline_abort_slot 3
 #define my_region_slot 6
 #define my_worker_id_slot 7
 #define SLOT_SIZE 8
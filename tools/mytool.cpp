@@ -85,11 +85,7 @@ static void post_read_hook(THREADID tid, syscall_ctx_t *ctx)
             read_off -= nr; // post
         }
         
-        for (unsigned int i = 0; i < nr; i++)
-        {
-            tag_t t = tag_alloc<tag_t>(read_off + i,tid);
-            tagmap_setb(buf + i, t);
-        }
+        tagmap_setn_offsets(buf, nr, read_off, tid);
     }
     else
     {
@@ -107,11 +103,7 @@ static void post_pread64_hook(THREADID tid, syscall_ctx_t *ctx)
     if (fdset.find(fd) != fdset.end())
     {
         unsigned int read_off = ctx->arg[SYSCALL_ARG3];        
-        for (unsigned int i = 0; i < nr; i++)
-        {
-            tag_t t = tag_alloc<tag_t>(read_off + i,tid);
-            tagmap_setb(buf + i, t);
-        }
+        tagmap_setn_offsets(buf, nr, read_off, tid);
     }
     else
     {
@@ -147,12 +139,8 @@ static void post_readv_hook(THREADID tid, syscall_ctx_t *ctx)
         if (it != fdset.end())
         {
             //fprintf(log_fd,"readbuf at %p\n",iov->iov_base);
-            for (size_t i = 0; i < iov_tot; i++)
-            {
-                tag_t t = tag_alloc<tag_t>(read_off,tid);
-                tagmap_setb(((ADDRINT)iov->iov_base) + i, t);
-                read_off++;
-            }
+            tagmap_setn_offsets((ADDRINT)iov->iov_base, iov_tot, read_off, tid);
+            read_off += iov_tot;
         }
         else
         {
@@ -184,10 +172,7 @@ static void post_mmap_hook(THREADID tid, syscall_ctx_t *ctx)
 
     if (fdset.find(fd) != fdset.end())
     {
-        for (unsigned int i = 0; i < offset; i++)
-        {
-            tagmap_setb(addr + i, tag_alloc<tag_t>(i,tid));
-        }
+        tagmap_setn_offsets(addr, offset, 0, tid);
     }
     else
     {